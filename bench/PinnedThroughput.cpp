@@ -0,0 +1,174 @@
+/** Benchmark comparing the toy throughput of unpinned and pinned pool workers,
+    with the read-only toy input either shared (allocated by the main thread)
+    or copied per NUMA node by a worker of that node (first touch).
+    Each fake toy streams through the shared expected bins, fluctuates them
+    into a per-worker buffer and reduces the buffer, which mimics the memory
+    traffic of toy generation and a chi-squared evaluation without any PrEW
+    input.
+
+    Usage: ./PinnedThroughput [--toys=N] [--bins=N_bins] [--passes=N]
+                              [--max-threads=N]
+**/
+
+#include <Parallel/CpuTopology.h>
+#include <Parallel/Latch.h>
+#include <Parallel/WorkStealingPool.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace PrEWUtils;
+
+//------------------------------------------------------------------------------
+
+enum class Mode { Unpinned, Pinned, PinnedNodeLocal };
+
+double fake_toy(const std::vector<double> &expected,
+                std::vector<double> *buffer, int n_passes, int seed) {
+  /** Stand-in for a toy fit that is dominated by reading the expected bins.
+   **/
+  double chi2 = 0;
+  for (int pass = 0; pass < n_passes; pass++) {
+    double shift = 1e-3 * (seed + pass);
+    for (std::size_t b = 0; b < expected.size(); b++) {
+      (*buffer)[b] = expected[b] + shift * std::sqrt(expected[b]);
+    }
+    for (std::size_t b = 0; b < expected.size(); b++) {
+      double diff = (*buffer)[b] - expected[b];
+      chi2 += diff * diff / expected[b];
+    }
+  }
+  return chi2;
+}
+
+double toys_per_second(Mode mode, int n_threads, int n_toys, int n_bins,
+                       int n_passes) {
+  /** Time all toys on a fresh pool in the given mode.
+   **/
+  std::vector<double> shared(static_cast<std::size_t>(n_bins));
+  for (std::size_t b = 0; b < shared.size(); b++) {
+    shared[b] = 10.0 + static_cast<double>(b % 100);
+  }
+
+  auto n_workers = static_cast<std::size_t>(n_threads);
+  auto cpus = Parallel::CpuTopology::spread_cpus(n_workers);
+  std::mutex node_mutex{};
+  std::map<int, std::unique_ptr<std::vector<double>>> node_copies{};
+  std::vector<const std::vector<double> *> worker_input(n_workers, &shared);
+  std::vector<std::vector<double>> buffers(n_workers);
+
+  Parallel::WorkStealingPool::WorkerInit init = nullptr;
+  if (mode != Mode::Unpinned) {
+    init = [&](int worker) {
+      auto w = static_cast<std::size_t>(worker);
+      Parallel::CpuTopology::pin_current_thread(cpus[w]);
+      buffers[w].resize(shared.size()); // First touch by the worker
+      if (mode == Mode::PinnedNodeLocal) {
+        std::lock_guard<std::mutex> lock(node_mutex);
+        auto &copy = node_copies[Parallel::CpuTopology::current_node()];
+        if (!copy) {
+          copy = std::make_unique<std::vector<double>>(shared);
+        }
+        worker_input[w] = copy.get();
+      }
+    };
+  }
+
+  Parallel::WorkStealingPool pool(n_workers, init);
+  // Let all workers run their init before timing
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  std::vector<double> results(static_cast<std::size_t>(n_toys));
+  Parallel::Latch latch(results.size());
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < n_toys; t++) {
+    pool.submit([&, t] {
+      auto w = static_cast<std::size_t>(
+          Parallel::WorkStealingPool::current_worker_index());
+      if (buffers[w].size() != shared.size()) {
+        buffers[w].resize(shared.size());
+      }
+      results[static_cast<std::size_t>(t)] =
+          fake_toy(*worker_input[w], &buffers[w], n_passes, t);
+      latch.count_down();
+    });
+  }
+  latch.wait();
+  auto stop = std::chrono::steady_clock::now();
+
+  double checksum = 0;
+  for (const auto &result : results) {
+    checksum += result;
+  }
+  if (std::isnan(checksum)) {
+    std::printf("Unexpected checksum\n");
+  }
+  std::chrono::duration<double> elapsed = stop - start;
+  return n_toys / elapsed.count();
+}
+
+int read_option(const std::string &arg, const std::string &name,
+                int current) {
+  /** Read an integer option of form --name=value.
+   **/
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) == 0) {
+    return std::stoi(arg.substr(prefix.size()));
+  }
+  return current;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int n_toys = 2000;
+  int n_bins = 1 << 18;
+  int n_passes = 4;
+  int max_threads = static_cast<int>(std::thread::hardware_concurrency());
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    n_toys = read_option(arg, "toys", n_toys);
+    n_bins = read_option(arg, "bins", n_bins);
+    n_passes = read_option(arg, "passes", n_passes);
+    max_threads = read_option(arg, "max-threads", max_threads);
+  }
+  if (max_threads < 1) {
+    max_threads = 1;
+  }
+
+  // Thread counts: powers of two up to the maximum, plus the maximum itself
+  std::vector<int> thread_counts{};
+  for (int n = 1; n < max_threads; n *= 2) {
+    thread_counts.push_back(n);
+  }
+  thread_counts.push_back(max_threads);
+
+  std::printf("Toys: %d, bins: %d, passes per toy: %d, NUMA nodes: %d\n",
+              n_toys, n_bins, n_passes, Parallel::CpuTopology::n_nodes());
+  std::printf("%8s %18s %18s %18s\n", "threads", "unpinned [toys/s]",
+              "pinned [toys/s]", "node-local [toys/s]");
+  for (int n_threads : thread_counts) {
+    double unpinned_rate =
+        toys_per_second(Mode::Unpinned, n_threads, n_toys, n_bins, n_passes);
+    double pinned_rate =
+        toys_per_second(Mode::Pinned, n_threads, n_toys, n_bins, n_passes);
+    double local_rate = toys_per_second(Mode::PinnedNodeLocal, n_threads,
+                                        n_toys, n_bins, n_passes);
+    std::printf("%8d %18.0f %18.0f %18.0f\n", n_threads, unpinned_rate,
+                pinned_rate, local_rate);
+  }
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+/** Benchmark comparing the toy throughput of linx::ThreadPool and
+    Parallel::WorkStealingPool when used the way ParallelRunner uses them:
+    every toy is enqueued as a single task and its future is collected.
+    The toys are replaced by a fixed amount of floating point work so that the
+    benchmark runs without any PrEW input.
+
+    Usage: ./PoolScaling [--toys=N] [--work=N_iterations] [--max-threads=N]
+**/
+
+#include <Parallel/ThreadPool.h>
+#include <Parallel/WorkStealingPool.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+double fake_toy(int n_iterations, int seed) {
+  /** Stand-in for a short toy fit: a fixed number of dependent floating point
+      operations that the compiler cannot remove.
+   **/
+  double x = 1.0 + 1e-3 * seed;
+  for (int i = 0; i < n_iterations; i++) {
+    x = std::sqrt(x * x + 1e-9 * i) + 1e-12;
+  }
+  return x;
+}
+
+template <class Pool>
+double toys_per_second(int n_threads, int n_toys, int n_iterations) {
+  /** Time the submission and collection of all toys on a fresh pool.
+   **/
+  Pool pool(static_cast<std::size_t>(n_threads));
+  std::vector<std::future<double>> futures(static_cast<std::size_t>(n_toys));
+
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < n_toys; t++) {
+    futures[static_cast<std::size_t>(t)] =
+        pool.enqueue([n_iterations, t] { return fake_toy(n_iterations, t); });
+  }
+  double checksum = 0;
+  for (auto &future : futures) {
+    checksum += future.get();
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  if (std::isnan(checksum)) {
+    std::printf("Unexpected checksum\n");
+  }
+  std::chrono::duration<double> elapsed = stop - start;
+  return n_toys / elapsed.count();
+}
+
+int read_option(const std::string &arg, const std::string &name,
+                int current) {
+  /** Read an integer option of form --name=value.
+   **/
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) == 0) {
+    return std::stoi(arg.substr(prefix.size()));
+  }
+  return current;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int n_toys = 200000;
+  int n_iterations = 2000;
+  int max_threads = static_cast<int>(std::thread::hardware_concurrency());
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    n_toys = read_option(arg, "toys", n_toys);
+    n_iterations = read_option(arg, "work", n_iterations);
+    max_threads = read_option(arg, "max-threads", max_threads);
+  }
+  if (max_threads < 1) {
+    max_threads = 1;
+  }
+
+  // Thread counts: powers of two up to the maximum, plus the maximum itself
+  std::vector<int> thread_counts{};
+  for (int n = 1; n < max_threads; n *= 2) {
+    thread_counts.push_back(n);
+  }
+  thread_counts.push_back(max_threads);
+
+  std::printf("Toys: %d, work per toy: %d iterations\n", n_toys, n_iterations);
+  std::printf("%8s %16s %16s %10s\n", "threads", "linx [toys/s]",
+              "stealing [toys/s]", "ratio");
+  for (int n_threads : thread_counts) {
+    double linx_rate = toys_per_second<PrEWUtils::linx::ThreadPool>(
+        n_threads, n_toys, n_iterations);
+    double stealing_rate =
+        toys_per_second<PrEWUtils::Parallel::WorkStealingPool>(
+            n_threads, n_toys, n_iterations);
+    std::printf("%8d %16.0f %16.0f %10.2f\n", n_threads, linx_rate,
+                stealing_rate, stealing_rate / linx_rate);
+  }
+
+  return 0;
+}
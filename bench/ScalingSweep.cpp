@@ -0,0 +1,175 @@
+/** End-to-end scaling sweep of the toy fits on synthetic setups (see
+    Setups/SyntheticSetup.h): for every combination of number of
+    distributions (which sets the number of fit parameters), bins per
+    distribution and number of threads a fixed number of toys is fitted with
+    ParallelRunner. Reports the toy throughput and the peak resident memory of
+    each run.
+    The peak memory is reset before each run where the kernel allows it
+    (/proc/self/clear_refs), otherwise it is the peak of the process so far.
+
+    Usage: ./ScalingSweep [--toys=N] [--threads=1,2,4] [--bins=20,80]
+                          [--distrs=2,8] [--tgcs=0|1] [--acc-boxes=0|1]
+                          [--af=0|1]
+                          [--minimizers=Migrad] [--prew-minimizer=ChiSquared]
+**/
+
+#include <Runners/ParallelRunner.h>
+#include <Setups/GeneralSetup.h>
+#include <Setups/SyntheticSetup.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace PrEWUtils;
+
+//------------------------------------------------------------------------------
+
+void reset_peak_rss() {
+  /** Reset the peak resident set size of the process (Linux >= 4.0).
+   **/
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+}
+
+double read_memory_mb(const std::string &field) {
+  /** Read a memory field (e.g. VmHWM, VmRSS) of /proc/self/status in MB.
+      Returns 0 if it is not available.
+   **/
+  std::ifstream status("/proc/self/status");
+  std::string line{};
+  while (std::getline(status, line)) {
+    if (line.compare(0, field.size() + 1, field + ":") == 0) {
+      std::istringstream values(line.substr(field.size() + 1));
+      double kB = 0;
+      values >> kB;
+      return kB / 1024.0;
+    }
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+int read_option(const std::string &arg, const std::string &name,
+                int current) {
+  /** Read an integer option of form --name=value.
+   **/
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) == 0) {
+    return std::stoi(arg.substr(prefix.size()));
+  }
+  return current;
+}
+
+std::string read_option(const std::string &arg, const std::string &name,
+                        const std::string &current) {
+  /** Read a string option of form --name=value.
+   **/
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) == 0) {
+    return arg.substr(prefix.size());
+  }
+  return current;
+}
+
+std::vector<int> read_option(const std::string &arg, const std::string &name,
+                             const std::vector<int> &current) {
+  /** Read a comma-separated integer list option of form --name=v1,v2,...
+   **/
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return current;
+  }
+  std::vector<int> values{};
+  std::istringstream list(arg.substr(prefix.size()));
+  std::string value{};
+  while (std::getline(list, value, ',')) {
+    values.push_back(std::stoi(value));
+  }
+  return values;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int n_toys = 200;
+  int max_threads = static_cast<int>(std::thread::hardware_concurrency());
+  std::vector<int> thread_counts{1, std::max(max_threads, 1)};
+  std::vector<int> bin_counts{20, 80};
+  std::vector<int> distr_counts{2, 8};
+  int use_TGCs = 1;
+  int use_acc_boxes = 1;
+  int use_Af = 0;
+  std::string minimizers = "Migrad";
+  std::string prew_minimizer = "ChiSquared";
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    n_toys = read_option(arg, "toys", n_toys);
+    thread_counts = read_option(arg, "threads", thread_counts);
+    bin_counts = read_option(arg, "bins", bin_counts);
+    distr_counts = read_option(arg, "distrs", distr_counts);
+    use_TGCs = read_option(arg, "tgcs", use_TGCs);
+    use_acc_boxes = read_option(arg, "acc-boxes", use_acc_boxes);
+    use_Af = read_option(arg, "af", use_Af);
+    minimizers = read_option(arg, "minimizers", minimizers);
+    prew_minimizer = read_option(arg, "prew-minimizer", prew_minimizer);
+  }
+
+  spdlog::set_level(spdlog::level::warn);
+
+  std::printf("Toys: %d, minimizers: %s|%s\n", n_toys, minimizers.c_str(),
+              prew_minimizer.c_str());
+  std::printf("%7s %10s %6s %8s %8s %12s %14s\n", "distrs", "bins/distr",
+              "pars", "threads", "toys/s", "setup [MB]", "peak RSS [MB]");
+
+  for (int n_distrs : distr_counts) {
+    for (int n_bins : bin_counts) {
+      Setups::SyntheticSetup::Config config{};
+      config.m_n_distrs = n_distrs;
+      config.m_n_bins = n_bins;
+      config.m_use_TGCs = (use_TGCs != 0);
+      config.m_use_acc_boxes = (use_acc_boxes != 0);
+      config.m_use_Af = (use_Af != 0);
+
+      // Memory needed for the setup and the runner's copy of it
+      double rss_before = read_memory_mb("VmRSS");
+      auto setup = Setups::SyntheticSetup::make_setup(config);
+      setup.complete_setup();
+      Runners::ParallelRunner<Setups::GeneralSetup> runner(setup, minimizers,
+                                                           prew_minimizer);
+      if (config.m_use_Af) {
+        runner.modify_fit(Setups::SyntheticSetup::make_modifier(config));
+      }
+      double setup_mb = read_memory_mb("VmRSS") - rss_before;
+      auto n_pars = setup.get_pars().size();
+
+      for (int n_threads : thread_counts) {
+        reset_peak_rss();
+        auto start = std::chrono::steady_clock::now();
+        auto results = runner.run_toy_fits(config.m_energy, n_toys, n_threads);
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        std::printf("%7d %10d %6zu %8d %8.1f %12.1f %14.1f\n", n_distrs,
+                    n_bins, n_pars, n_threads,
+                    results.size() / elapsed.count(), setup_mb,
+                    read_memory_mb("VmHWM"));
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,368 @@
+/** Microbenchmarks of the setup construction: completing a GeneralSetup and
+    the DataHelp, SetupHelp and Names utilities it is built from, each at a
+    realistic scale and at ten times that scale (ten times the number of
+    distributions and therefore of parameters, coefficients, links and bins).
+    The input is generated by Setups::SyntheticSetup instead of being read
+    from files.
+
+    The result of each benchmark is the median time per call over several
+    samples. Results can be stored as a JSON baseline, later runs can be
+    compared against such a baseline, which flags each benchmark that got
+    slower by more than the threshold (relative, 0.1 = 10%).
+
+    Usage: ./SetupBench [--samples=N] [--min-sample-ms=N]
+                        [--write-baseline=file.json]
+                        [--compare=file.json] [--threshold=0.1]
+    Exits with 1 if the comparison found regressions.
+**/
+
+#include <DataHelp/BinSelector.h>
+#include <DataHelp/CoefDistrHelp.h>
+#include <DataHelp/FitParHelp.h>
+#include <DataHelp/PredLinkHelp.h>
+#include <Names/MinimizerNaming.h>
+#include <SetupHelp/ParOrder.h>
+#include <Setups/GeneralSetup.h>
+#include <Setups/SyntheticSetup.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace PrEWUtils;
+
+//------------------------------------------------------------------------------
+
+struct Scale {
+  std::string m_name{};
+  int m_n_distrs{};
+  int m_n_bins{}; // Per distribution and chiral configuration
+  int m_n_minimizers{};
+};
+
+//------------------------------------------------------------------------------
+// Synthetic input
+
+Setups::SyntheticSetup::Config make_config(const Scale &scale) {
+  Setups::SyntheticSetup::Config config{};
+  config.m_n_distrs = scale.m_n_distrs;
+  config.m_n_bins = scale.m_n_bins;
+  config.m_use_acc_boxes = true;
+  config.m_use_TGCs = true;
+  return config;
+}
+
+PrEW::Data::PredLinkVec make_links(const Scale &scale) {
+  /** Two links for each distribution, so that half of them have to be merged
+      into existing ones.
+   **/
+  auto config = make_config(scale);
+  PrEW::Data::PredLinkVec links{};
+  for (int i = 0; i < 2; i++) {
+    for (int d = 0; d < scale.m_n_distrs; d++) {
+      for (const auto &chiral_config : config.m_chiral_configs) {
+        PrEW::Data::DistrInfo info{Setups::SyntheticSetup::distr_name(d),
+                                   chiral_config, config.m_energy};
+        PrEW::Data::FctLink fct_link{
+            "Constant", {"SynthPar" + std::to_string(i)}, {}};
+        links.push_back(PrEW::Data::PredLink{info, {fct_link}, {}});
+      }
+    }
+  }
+  return links;
+}
+
+std::string make_minimizer_str(const Scale &scale) {
+  std::string min_str{};
+  for (int m = 0; m < scale.m_n_minimizers; m++) {
+    min_str += (m > 0) ? "->" : "";
+    min_str += (m % 2 == 0) ? "Migrad(100000,100000,0.0001)" : "Simplex";
+  }
+  return min_str;
+}
+
+//------------------------------------------------------------------------------
+// Timing
+
+struct TimingOptions {
+  int m_n_samples{15};
+  double m_min_sample_time{0.01}; // seconds
+};
+
+template <class Input>
+double ns_per_call(const Input &input, std::function<void(Input &)> fct,
+                   const TimingOptions &options) {
+  /** Median time in ns of calling the function on a fresh copy of the input.
+      Each sample calls the function often enough to take at least the
+      minimum sample time, the copies are made before the clock starts.
+   **/
+  using Clock = std::chrono::steady_clock;
+  auto sample = [&](std::size_t n_calls) {
+    std::vector<Input> copies(n_calls, input);
+    auto start = Clock::now();
+    for (auto &copy : copies) {
+      fct(copy);
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    return elapsed.count();
+  };
+
+  // Calibrate the number of calls per sample
+  std::size_t n_calls = 1;
+  while ((sample(n_calls) < options.m_min_sample_time) &&
+         (n_calls < (1u << 16))) {
+    n_calls *= 2;
+  }
+
+  std::vector<double> samples{};
+  for (int s = 0; s < options.m_n_samples; s++) {
+    samples.push_back(1e9 * sample(n_calls) / static_cast<double>(n_calls));
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+//------------------------------------------------------------------------------
+
+using Results = std::map<std::string, double>; // Name -> ns per call
+
+void run_scale(const Scale &scale, const TimingOptions &options,
+               Results *results) {
+  /** Run all benchmarks at the given scale.
+   **/
+  auto config = make_config(scale);
+  auto setup = Setups::SyntheticSetup::make_setup(config);
+  auto completed_setup = setup;
+  completed_setup.complete_setup();
+  const auto &pars = completed_setup.get_pars();
+  auto coefs = Setups::SyntheticSetup::make_coefs(config);
+
+  auto name = [&scale](const std::string &benchmark) {
+    return benchmark + "/" + scale.m_name;
+  };
+
+  (*results)[name("complete_setup")] = ns_per_call<Setups::GeneralSetup>(
+      setup, [](Setups::GeneralSetup &s) { s.complete_setup(); }, options);
+
+  // Half of the added elements already exist in the target vector
+  PrEW::Fit::ParVec half_pars(pars.begin(), pars.begin() + pars.size() / 2);
+  (*results)[name("add_pars_to_vec")] = ns_per_call<PrEW::Fit::ParVec>(
+      half_pars,
+      [&pars](PrEW::Fit::ParVec &vec) {
+        DataHelp::FitParHelp::add_pars_to_vec(pars, vec);
+      },
+      options);
+
+  PrEW::Data::CoefDistrVec half_coefs(coefs.begin(),
+                                      coefs.begin() + coefs.size() / 2);
+  (*results)[name("add_coefs_to_vec")] = ns_per_call<PrEW::Data::CoefDistrVec>(
+      half_coefs,
+      [&coefs](PrEW::Data::CoefDistrVec &vec) {
+        DataHelp::CoefDistrHelp::add_coefs_to_vec(coefs, vec);
+      },
+      options);
+
+  auto links = make_links(scale);
+  (*results)[name("add_links_to_vec")] = ns_per_call<PrEW::Data::PredLinkVec>(
+      {},
+      [&links](PrEW::Data::PredLinkVec &vec) {
+        DataHelp::PredLinkHelp::add_links_to_vec(links, vec);
+      },
+      options);
+
+  (*results)[name("reorder_pars")] = ns_per_call<PrEW::Fit::ParVec>(
+      pars,
+      [](PrEW::Fit::ParVec &vec) {
+        vec = SetupHelp::ParOrder::reorder_pars(vec);
+      },
+      options);
+
+  // Cut away the quarter of bins with the lowest prediction
+  auto connector = completed_setup.get_data_connector();
+  PrEW::Fit::FitContainer container{};
+  connector.fill_fit_container(connector.get_pred_distrs(), pars, &container);
+  std::vector<double> predictions{};
+  for (const auto &bin : container.m_fit_bins) {
+    predictions.push_back(bin.get_val_prd());
+  }
+  std::sort(predictions.begin(), predictions.end());
+  DataHelp::BinSelector selector(predictions.at(predictions.size() / 4), pars);
+  (*results)[name("remove_bins")] = ns_per_call<PrEW::Fit::FitContainer>(
+      container,
+      [&selector](PrEW::Fit::FitContainer &c) { selector.remove_bins(&c); },
+      options);
+
+  auto min_str = make_minimizer_str(scale);
+  (*results)[name("read_mininimizer_str")] = ns_per_call<std::string>(
+      min_str,
+      [](std::string &str) {
+        Names::MinimizerNaming::read_mininimizer_str(str);
+      },
+      options);
+}
+
+//------------------------------------------------------------------------------
+// Baselines
+
+void write_baseline(const std::string &path, const Results &results) {
+  std::ofstream file(path);
+  file.precision(10);
+  file << "{\n  \"unit\": \"ns/call\",\n  \"benchmarks\": {";
+  bool is_first = true;
+  for (const auto &result : results) {
+    file << (is_first ? "\n" : ",\n") << "    \"" << result.first
+         << "\": " << result.second;
+    is_first = false;
+  }
+  file << "\n  }\n}\n";
+}
+
+Results read_baseline(const std::string &path) {
+  /** Read the benchmark entries of a baseline written by write_baseline.
+   **/
+  std::ifstream file(path);
+  if (!file) {
+    throw std::invalid_argument("SetupBench: Can't open baseline " + path);
+  }
+  std::stringstream content{};
+  content << file.rdbuf();
+  std::string text = content.str();
+  auto benchmarks_pos = text.find("\"benchmarks\"");
+  if (benchmarks_pos == std::string::npos) {
+    throw std::invalid_argument("SetupBench: No benchmarks in " + path);
+  }
+  text = text.substr(benchmarks_pos + 12);
+
+  Results baseline{};
+  std::regex entry_regex("\"([^\"]+)\"\\s*:\\s*([-+0-9.eE]+)");
+  for (std::sregex_iterator it(text.begin(), text.end(), entry_regex), end;
+       it != end; ++it) {
+    baseline[(*it)[1]] = std::stod((*it)[2]);
+  }
+  return baseline;
+}
+
+int compare(const Results &results, const Results &baseline,
+            double threshold) {
+  /** Print the relative changes and return the number of regressions.
+   **/
+  int n_regressions = 0;
+  std::printf("%-34s %14s %14s %9s\n", "benchmark", "baseline [ns]",
+              "current [ns]", "change");
+  for (const auto &result : results) {
+    auto baseline_it = baseline.find(result.first);
+    if (baseline_it == baseline.end()) {
+      std::printf("%-34s %14s %14.0f %9s\n", result.first.c_str(), "-",
+                  result.second, "new");
+      continue;
+    }
+    double change = result.second / baseline_it->second - 1.0;
+    bool is_regression = change > threshold;
+    n_regressions += is_regression;
+    std::printf("%-34s %14.0f %14.0f %+8.1f%% %s\n", result.first.c_str(),
+                baseline_it->second, result.second, 100.0 * change,
+                is_regression ? "REGRESSION" : "");
+  }
+  return n_regressions;
+}
+
+//------------------------------------------------------------------------------
+
+int read_option(const std::string &arg, const std::string &name,
+                int current) {
+  /** Read an integer option of form --name=value.
+   **/
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) == 0) {
+    return std::stoi(arg.substr(prefix.size()));
+  }
+  return current;
+}
+
+double read_option(const std::string &arg, const std::string &name,
+                   double current) {
+  /** Read a floating point option of form --name=value.
+   **/
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) == 0) {
+    return std::stod(arg.substr(prefix.size()));
+  }
+  return current;
+}
+
+std::string read_option(const std::string &arg, const std::string &name,
+                        const std::string &current) {
+  /** Read a string option of form --name=value.
+   **/
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) == 0) {
+    return arg.substr(prefix.size());
+  }
+  return current;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  TimingOptions options{};
+  int min_sample_ms = 10;
+  std::string baseline_out{};
+  std::string baseline_in{};
+  double threshold = 0.1;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    options.m_n_samples = read_option(arg, "samples", options.m_n_samples);
+    min_sample_ms = read_option(arg, "min-sample-ms", min_sample_ms);
+    baseline_out = read_option(arg, "write-baseline", baseline_out);
+    baseline_in = read_option(arg, "compare", baseline_in);
+    threshold = read_option(arg, "threshold", threshold);
+  }
+  options.m_n_samples = std::max(options.m_n_samples, 1);
+  options.m_min_sample_time = 1e-3 * min_sample_ms;
+
+  // The setup code logs on debug level only, keep the output clean anyway
+  spdlog::set_level(spdlog::level::warn);
+
+  const std::vector<Scale> scales{{"realistic", 10, 40, 3},
+                                  {"10x", 100, 40, 30}};
+  Results results{};
+  for (const auto &scale : scales) {
+    run_scale(scale, options, &results);
+  }
+
+  if (!baseline_out.empty()) {
+    write_baseline(baseline_out, results);
+  }
+
+  if (baseline_in.empty()) {
+    std::printf("%-34s %14s\n", "benchmark", "time [ns]");
+    for (const auto &result : results) {
+      std::printf("%-34s %14.0f\n", result.first.c_str(), result.second);
+    }
+    return 0;
+  }
+
+  int n_regressions = compare(results, read_baseline(baseline_in), threshold);
+  if (n_regressions > 0) {
+    std::printf("%d regression(s) beyond %.0f%%\n", n_regressions,
+                100.0 * threshold);
+    return 1;
+  }
+  return 0;
+}
@@ -2,9 +2,13 @@
 #define LIB_BINSELECTOR_H 1
 
 // Includes from PrEW
+#include "Data/PredDistr.h"
 #include "Fit/FitContainer.h"
 #include "Fit/FitPar.h"
 
+#include <string>
+#include <vector>
+
 // TODO TODO TODO This should be part of PrEW
 namespace PrEWUtils {
 namespace DataHelp {
@@ -15,18 +19,78 @@ namespace DataHelp {
         The cutoff checks the bin prediction for a given set of parameter values
         and if it is below a given cutoff the bin is not considered in the 
         minimization.
+        Additional criteria can be combined with the cutoff, a bin is only
+        kept if it passes all of them:
+          - coordinate ranges of a distribution
+          - fixed masks of the bins of a distribution
+        None of the criteria depend on the measured data, so the resulting
+        mask is computed once and then applied to each toy container.
     **/
+    
+    struct CoordRange {
+      std::string m_distr_name {};
+      int m_coord_index {};
+      double m_min {};
+      double m_max {};
+    };
+    struct DistrMask {
+      std::string m_distr_name {};
+      std::vector<bool> m_keep {};
+    };
 
     double m_cut_val {}; 
     PrEW::Fit::ParVec m_pars_for_cut {};
+    std::vector<CoordRange> m_coord_ranges {};
+    std::vector<DistrMask> m_distr_masks {};
 
     public:
+      using BinMask = std::vector<bool>; // true -> Bin is kept
+      
       // Constructors
       BinSelector() {};
       BinSelector(double cut_val, PrEW::Fit::ParVec pars_for_cut);
       
+      // Additional criteria
+      void add_coord_range(
+        const std::string & distr_name,
+        int coord_index,
+        double min,
+        double max
+      );
+      void add_distr_mask(
+        const std::string & distr_name,
+        const std::vector<bool> & keep
+      );
+      bool uses_distrs() const;
+      
       // Core functionality
-      void remove_bins(PrEW::Fit::FitContainer * container) const;
+      BinMask get_mask(
+        PrEW::Fit::FitContainer * container,
+        const PrEW::Data::PredDistrVec & distrs
+      ) const;
+      std::vector<int> remove_bins(
+        PrEW::Fit::FitContainer * container,
+        const PrEW::Data::PredDistrVec & distrs
+      ) const;
+      std::vector<int> remove_bins(PrEW::Fit::FitContainer * container) const;
+      
+      // Applying a mask
+      static std::vector<int> get_kept_indices(const BinMask & mask);
+      static void compact(
+        const BinMask & mask,
+        PrEW::Fit::FitContainer * container
+      );
+      
+    protected:
+      // Internal functions
+      void apply_cut(
+        PrEW::Fit::FitContainer * container,
+        BinMask * mask
+      ) const;
+      void apply_distr_criteria(
+        const PrEW::Data::PredDistrVec & distrs,
+        BinMask * mask
+      ) const;
   };
   
 } // Namespace DataHelp
@@ -0,0 +1,65 @@
+#ifndef LIB_ASYNCSINK_H
+#define LIB_ASYNCSINK_H 1
+
+#include <Output/ResultSink.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace PrEWUtils {
+namespace Output {
+
+class AsyncSink : public ResultSink {
+  /** Sink that hands results to another sink on a dedicated writer thread.
+      Fitting threads only move their result into a bounded queue, the
+      (potentially slow) output of the target sink happens on the writer
+      thread.
+      If the queue is full the producers wait, which keeps the memory bounded
+      when the target can't keep up.
+      Once the target fails, consume rethrows its error.
+      Destroying the sink without finishing it aborts the target.
+  **/
+
+  ResultSink *m_target{};
+  std::size_t m_capacity{};
+
+  std::deque<std::pair<ToyInfo, PrEW::Fit::FitResult>> m_queue{};
+  bool m_finishing{false};
+  bool m_finished{false};
+  std::exception_ptr m_error{};
+
+  std::mutex m_mutex{};
+  std::condition_variable m_not_empty{};
+  std::condition_variable m_not_full{};
+  std::thread m_writer{};
+
+public:
+  // Constructors
+  AsyncSink(ResultSink *target, std::size_t capacity = 1024);
+  ~AsyncSink();
+
+  AsyncSink(const AsyncSink &) = delete;
+  AsyncSink &operator=(const AsyncSink &) = delete;
+
+  // Thread-safe, can be called from any number of threads
+  void consume(const ToyInfo &info, PrEW::Fit::FitResult result) override;
+
+  // Drain the queue, finish the target and rethrow writer errors
+  void finish() override;
+  // Drain the queue and abort the target
+  void abort() override;
+
+protected:
+  bool stop_writer();
+  void write_loop();
+};
+
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef LIB_CHECKPOINTSINK_H
+#define LIB_CHECKPOINTSINK_H 1
+
+#include <Output/ResultIO.h>
+#include <Output/ResultSink.h>
+
+// Includes from PrEW
+#include "Fit/FitResult.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace PrEWUtils {
+namespace Output {
+
+class CheckpointSink : public ResultSink {
+  /** Sink that periodically writes the received results into binary segment
+      files in a checkpoint directory.
+      Each segment is written to a temporary file and renamed afterwards, so a
+      run that is killed never leaves a partial segment behind.
+      Time-based segments are also written while waiting for results if the
+      sink is polled (e.g. behind an AsyncSink).
+      All segments carry the fingerprint of the setup they belong to, results
+      of other setups in the same directory are ignored when loading.
+  **/
+
+public:
+  // Finished results per energy and toy index
+  using Data = ResultIO::ResultMap;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  std::string m_directory{};
+  std::uint64_t m_fingerprint{};
+  std::size_t m_toys_per_segment{};
+  std::chrono::duration<double> m_max_interval{};
+
+  std::string m_run_id{}; // Keeps segment names of restarted runs distinct
+  int m_n_segments{0};
+  Clock::time_point m_last_write{};
+  ResultIO::InfoResultVec m_buffer{};
+
+public:
+  // Constructors
+  CheckpointSink(const std::string &directory, std::uint64_t fingerprint,
+                 std::size_t toys_per_segment = 100,
+                 std::chrono::duration<double> max_interval =
+                     std::chrono::minutes(5));
+
+  void consume(const ToyInfo &info, PrEW::Fit::FitResult result) override;
+  void finish() override;
+  void abort() override;
+  void poll() override;
+
+  // Read all results of the given setup from a checkpoint directory
+  static Data load(const std::string &directory, std::uint64_t fingerprint);
+
+protected:
+  void write_segment();
+  static std::string segment_prefix(std::uint64_t fingerprint);
+};
+
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef LIB_COLUMNARFILE_H
+#define LIB_COLUMNARFILE_H 1
+
+#include <Output/ColumnarFormat.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Output {
+
+template <class T> class Column {
+  /** View of one column of a columnar result file, spread over its blocks.
+      Either index toys directly or loop over the blocks, whose values are
+      contiguous in memory.
+   **/
+
+  const char *m_data{};
+  std::size_t m_offset{};
+  std::size_t m_block_bytes{};
+  std::size_t m_block_size{};
+  std::size_t m_size{};
+
+public:
+  Column(const char *data, std::size_t offset, std::size_t block_bytes,
+         std::size_t block_size, std::size_t size);
+
+  T operator[](std::size_t toy) const;
+  std::size_t size() const;
+
+  // Block-wise access
+  std::size_t get_n_blocks() const;
+  const T *block_data(std::size_t block) const;
+  std::size_t block_size(std::size_t block) const;
+};
+
+//------------------------------------------------------------------------------
+
+class ColumnarFile {
+  /** Read-only memory map of a columnar result file (see
+      Output/ColumnarFormat.h).
+      Columns are read directly from the mapped file, nothing is parsed or
+      copied beyond the header, e.g. for pulls over millions of toys:
+        auto vals = file.par_vals(p); auto uncs = file.par_uncs(p);
+        pull = (vals[t] - file.get_ref_vals()[p]) / uncs[t];
+      The file must not be changed while it is mapped.
+   **/
+
+  std::string m_path{};
+  const char *m_map{nullptr};
+  std::size_t m_map_size{0};
+
+  ColumnarFormat::FixedHeader m_header{};
+  ColumnarFormat::Layout m_layout{0, 0, false};
+  std::vector<std::string> m_par_names{};
+  std::vector<double> m_ref_vals{};
+  std::size_t m_data_offset{}; // Start of the first block
+
+public:
+  // Constructors
+  explicit ColumnarFile(const std::string &path);
+  ~ColumnarFile();
+
+  ColumnarFile(const ColumnarFile &) = delete;
+  ColumnarFile &operator=(const ColumnarFile &) = delete;
+
+  // Access functions
+  std::uint64_t get_fingerprint() const;
+  std::size_t get_n_results() const;
+  std::size_t get_block_size() const;
+  const std::vector<std::string> &get_par_names() const;
+  const std::vector<double> &get_ref_vals() const;
+  std::size_t get_par_index(const std::string &par_name) const;
+  bool has_covariance() const;
+
+  // Columns
+  Column<std::int32_t> energies() const;
+  Column<std::int32_t> toy_indices() const;
+  Column<std::int32_t> statuses() const;
+  Column<std::int32_t> n_calls() const;
+  Column<double> fcns() const;
+  Column<double> edms() const;
+  Column<double> par_vals(std::size_t par) const;
+  Column<double> par_uncs(std::size_t par) const;
+  Column<double> covariances(std::size_t par_1, std::size_t par_2) const;
+
+protected:
+  void read_header();
+  template <class T> Column<T> column(std::size_t offset) const;
+  void check_par(std::size_t par) const;
+};
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+template <class T>
+Column<T>::Column(const char *data, std::size_t offset,
+                  std::size_t block_bytes, std::size_t block_size,
+                  std::size_t size)
+    : m_data(data), m_offset(offset), m_block_bytes(block_bytes),
+      m_block_size(block_size), m_size(size) {}
+
+template <class T> T Column<T>::operator[](std::size_t toy) const {
+  return this->block_data(toy / m_block_size)[toy % m_block_size];
+}
+
+template <class T> std::size_t Column<T>::size() const { return m_size; }
+
+template <class T> std::size_t Column<T>::get_n_blocks() const {
+  return (m_size + m_block_size - 1) / m_block_size;
+}
+
+template <class T>
+const T *Column<T>::block_data(std::size_t block) const {
+  return reinterpret_cast<const T *>(m_data + block * m_block_bytes +
+                                     m_offset);
+}
+
+template <class T>
+std::size_t Column<T>::block_size(std::size_t block) const {
+  /** Number of valid toys in the block.
+   **/
+  auto first = block * m_block_size;
+  return (first + m_block_size <= m_size) ? m_block_size : m_size - first;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
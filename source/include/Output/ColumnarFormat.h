@@ -0,0 +1,133 @@
+#ifndef LIB_COLUMNARFORMAT_H
+#define LIB_COLUMNARFORMAT_H 1
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PrEWUtils {
+namespace Output {
+namespace ColumnarFormat {
+/** Layout of columnar (struct-of-arrays) toy result files.
+    A file is a header followed by blocks of a fixed number of toys. Within a
+    block every quantity is a contiguous column:
+      energy, toy index, status, FCN calls   (int32 each)
+      FCN minimum, EDM                       (double each)
+      final value of each parameter          (double, one column per par)
+      final uncertainty of each parameter    (double, one column per par)
+      covariance upper triangle (optional)   (double, row-major, p <= q)
+    The last block is written in full, only the first n_results toys of the
+    file are valid.
+    The header holds the fixed fields below, then the parameter names (each
+    as uint32 length and characters) and the reference (initial) values of
+    the parameters, all padded so that the blocks start 64-byte aligned.
+    Numbers are written in the native byte order, files are meant to be read
+    back on the same kind of machine.
+ **/
+
+const char file_magic[8] = {'P', 'R', 'U', 'C', 'O', 'L', 'S', '\0'};
+constexpr std::uint32_t file_version = 1;
+
+enum Flags : std::uint32_t { HasCovariance = 1 };
+
+struct FixedHeader {
+  char m_magic[8]{};
+  std::uint32_t m_version{};
+  std::uint32_t m_n_pars{};
+  std::uint64_t m_fingerprint{};
+  std::uint64_t m_n_results{};
+  std::uint32_t m_block_size{}; // Toys per block
+  std::uint32_t m_flags{};
+};
+
+constexpr std::size_t header_alignment = 64;
+
+//------------------------------------------------------------------------------
+
+class Layout {
+  /** Byte offsets of the columns within a block.
+   **/
+
+  std::size_t m_block_size{};
+  std::size_t m_n_pars{};
+  bool m_has_cov{};
+
+public:
+  Layout(std::size_t block_size, std::size_t n_pars, bool has_cov);
+
+  std::size_t get_block_size() const;
+  std::size_t get_n_cov() const;
+  std::size_t get_block_bytes() const;
+
+  // Column offsets in bytes from the start of the block
+  std::size_t energy() const;
+  std::size_t toy_index() const;
+  std::size_t status() const;
+  std::size_t n_calls() const;
+  std::size_t fcn() const;
+  std::size_t edm() const;
+  std::size_t par_val(std::size_t par) const;
+  std::size_t par_unc(std::size_t par) const;
+  std::size_t cov(std::size_t par_1, std::size_t par_2) const;
+};
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+inline Layout::Layout(std::size_t block_size, std::size_t n_pars,
+                      bool has_cov)
+    : m_block_size(block_size), m_n_pars(n_pars), m_has_cov(has_cov) {}
+
+inline std::size_t Layout::get_block_size() const { return m_block_size; }
+
+inline std::size_t Layout::get_n_cov() const {
+  return m_has_cov ? m_n_pars * (m_n_pars + 1) / 2 : 0;
+}
+
+inline std::size_t Layout::get_block_bytes() const {
+  return m_block_size * (4 * sizeof(std::int32_t) + 2 * sizeof(double) +
+                         (2 * m_n_pars + this->get_n_cov()) * sizeof(double));
+}
+
+//------------------------------------------------------------------------------
+
+inline std::size_t Layout::energy() const { return 0; }
+inline std::size_t Layout::toy_index() const {
+  return m_block_size * sizeof(std::int32_t);
+}
+inline std::size_t Layout::status() const {
+  return 2 * m_block_size * sizeof(std::int32_t);
+}
+inline std::size_t Layout::n_calls() const {
+  return 3 * m_block_size * sizeof(std::int32_t);
+}
+inline std::size_t Layout::fcn() const {
+  return 4 * m_block_size * sizeof(std::int32_t);
+}
+inline std::size_t Layout::edm() const {
+  return this->fcn() + m_block_size * sizeof(double);
+}
+inline std::size_t Layout::par_val(std::size_t par) const {
+  return this->edm() + (1 + par) * m_block_size * sizeof(double);
+}
+inline std::size_t Layout::par_unc(std::size_t par) const {
+  return this->par_val(m_n_pars + par);
+}
+
+inline std::size_t Layout::cov(std::size_t par_1, std::size_t par_2) const {
+  /** Offset of the covariance of two parameters (in any order).
+   **/
+  if (par_1 > par_2) {
+    return this->cov(par_2, par_1);
+  }
+  auto index = par_1 * (2 * m_n_pars - par_1 + 1) / 2 + (par_2 - par_1);
+  return this->par_val(2 * m_n_pars + index);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace ColumnarFormat
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef LIB_COLUMNARSINK_H
+#define LIB_COLUMNARSINK_H 1
+
+#include <Output/ColumnarFormat.h>
+#include <Output/ResultSink.h>
+
+// Includes from PrEW
+#include "Fit/FitPar.h"
+#include "Fit/FitResult.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Output {
+
+class ColumnarSink : public ResultSink {
+  /** Sink that streams all results into a columnar result file (see
+      Output/ColumnarFormat.h), to be read back without parsing through
+      Output/ColumnarFile.h.
+      The parameters (names and reference values, in the order of the fit,
+      e.g. ParallelRunner::get_pars) are stored once in the header, all
+      results must have exactly these parameters (with a reduced result
+      fidelity use ParallelRunner::get_result_pars). Results of several
+      energies can only share a file if their parameters are the same.
+      Quantities missing from the results are stored as NaN.
+      A block of toys is filled in memory and written once it is full, the
+      block size is reduced if a block would exceed max_block_bytes (e.g.
+      covariances of many parameters). Like ResultFileSink the file only
+      appears at its path once it is finished.
+  **/
+
+  std::string m_path{};
+  ColumnarFormat::FixedHeader m_header{};
+  ColumnarFormat::Layout m_layout;
+  std::vector<std::string> m_par_names{};
+
+  std::vector<char> m_block{}; // Block currently being filled
+  std::size_t m_n_in_block{0};
+  std::ofstream m_file{};
+  bool m_finished{false};
+
+public:
+  static constexpr std::size_t max_block_bytes = 16 << 20;
+
+  // Constructors
+  ColumnarSink(const std::string &path, std::uint64_t fingerprint,
+               const PrEW::Fit::ParVec &pars, std::size_t block_size = 4096,
+               bool store_covariance = false);
+
+  void consume(const ToyInfo &info, PrEW::Fit::FitResult result) override;
+  void finish() override;
+  void abort() override;
+
+protected:
+  static std::size_t fit_block_size(std::size_t block_size,
+                                    std::size_t n_pars, bool store_covariance);
+  template <class T> void set(std::size_t offset, T value);
+  void write_header(const PrEW::Fit::ParVec &pars);
+  void write_block();
+};
+
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef LIB_FINGERPRINT_H
+#define LIB_FINGERPRINT_H 1
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Output {
+
+class Fingerprint {
+  /** Incremental 64 bit FNV-1a hash used to recognise results that were
+      produced with an identical setup.
+      Not suitable against deliberate collisions, only against mix-ups.
+  **/
+
+  std::uint64_t m_hash{14695981039346656037ull};
+
+public:
+  void add_bytes(const void *data, std::size_t n_bytes);
+  void add(std::int64_t value);
+  void add(double value);
+  void add(const std::string &str);
+  void add(const std::vector<double> &values);
+  void add(const std::vector<int> &values);
+
+  std::uint64_t get() const;
+};
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+inline void Fingerprint::add_bytes(const void *data, std::size_t n_bytes) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  for (std::size_t i = 0; i < n_bytes; i++) {
+    m_hash ^= bytes[i];
+    m_hash *= 1099511628211ull;
+  }
+}
+
+inline void Fingerprint::add(std::int64_t value) {
+  this->add_bytes(&value, sizeof(value));
+}
+
+inline void Fingerprint::add(double value) {
+  this->add_bytes(&value, sizeof(value));
+}
+
+inline void Fingerprint::add(const std::string &str) {
+  // Length first so that consecutive strings can't be confused
+  this->add(static_cast<std::int64_t>(str.size()));
+  this->add_bytes(str.data(), str.size());
+}
+
+inline void Fingerprint::add(const std::vector<double> &values) {
+  this->add(static_cast<std::int64_t>(values.size()));
+  this->add_bytes(values.data(), values.size() * sizeof(double));
+}
+
+inline void Fingerprint::add(const std::vector<int> &values) {
+  this->add(static_cast<std::int64_t>(values.size()));
+  for (const auto &value : values) {
+    this->add(static_cast<std::int64_t>(value));
+  }
+}
+
+inline std::uint64_t Fingerprint::get() const { return m_hash; }
+
+//------------------------------------------------------------------------------
+
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
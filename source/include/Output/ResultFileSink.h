@@ -0,0 +1,42 @@
+#ifndef LIB_RESULTFILESINK_H
+#define LIB_RESULTFILESINK_H 1
+
+#include <Output/ResultSink.h>
+
+// Includes from PrEW
+#include "Fit/FitResult.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace PrEWUtils {
+namespace Output {
+
+class ResultFileSink : public ResultSink {
+  /** Sink that streams all results into a single binary result file (see
+      Output/ResultIO.h), e.g. the output of one shard of a campaign.
+      The results go into a temporary file that only gets renamed to the
+      requested path once it is finished, so the path either holds a complete
+      file or nothing.
+  **/
+
+  std::string m_path{};
+  std::uint64_t m_fingerprint{};
+  std::uint64_t m_n_results{0};
+  std::ofstream m_file{};
+  bool m_finished{false};
+
+public:
+  // Constructors
+  ResultFileSink(const std::string &path, std::uint64_t fingerprint);
+
+  void consume(const ToyInfo &info, PrEW::Fit::FitResult result) override;
+  void finish() override;
+  void abort() override;
+};
+
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef LIB_RESULTIO_H
+#define LIB_RESULTIO_H 1
+
+#include <Output/ResultSink.h>
+
+// Includes from PrEW
+#include "Fit/FitResult.h"
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Output {
+namespace ResultIO {
+/** Namespace for the binary (de)serialisation of single toy results.
+    A result file starts with a header holding the fingerprint of the setup
+    and the number of results that follow.
+    Numbers are written in the native byte order, files are meant to be read
+    back on the same kind of machine.
+ **/
+
+void write_file_header(std::ostream &out, std::uint64_t fingerprint,
+                       std::uint64_t n_results);
+void read_file_header(std::istream &in, std::uint64_t *fingerprint,
+                      std::uint64_t *n_results);
+
+void write_result(std::ostream &out, const ToyInfo &info,
+                  const PrEW::Fit::FitResult &result);
+void read_result(std::istream &in, ToyInfo *info,
+                 PrEW::Fit::FitResult *result);
+
+// Whole files, written atomically through a temporary file
+using InfoResultVec = std::vector<std::pair<ToyInfo, PrEW::Fit::FitResult>>;
+void write_file(const std::string &path, std::uint64_t fingerprint,
+                const InfoResultVec &results);
+InfoResultVec read_file(const std::string &path, std::uint64_t *fingerprint);
+
+// Results per energy and toy index
+using ResultMap = std::map<int, std::map<int, PrEW::Fit::FitResult>>;
+
+} // namespace ResultIO
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
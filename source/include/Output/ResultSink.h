@@ -0,0 +1,60 @@
+#ifndef LIB_RESULTSINK_H
+#define LIB_RESULTSINK_H 1
+
+// Includes from PrEW
+#include "Fit/FitResult.h"
+
+#include <functional>
+
+namespace PrEWUtils {
+namespace Output {
+
+struct ToyInfo {
+  /** Identification of a single toy within a toy campaign.
+   **/
+  int m_energy{};
+  int m_toy_index{};
+};
+
+class ResultSink {
+  /** Interface for objects that receive toy fit results one at a time as soon
+      as the toy is finished, instead of collecting all of them in memory.
+      When handed to a runner the sink is only ever called from a single
+      writer thread, so implementations don't need to be thread-safe.
+      A run ends with either finish (all results were delivered) or abort
+      (the run failed), sinks must not complete their output on abort.
+      Writer threads call poll regularly while no results arrive, e.g. for
+      output that is due after some time.
+  **/
+
+public:
+  virtual ~ResultSink() = default;
+
+  virtual void consume(const ToyInfo &info, PrEW::Fit::FitResult result) = 0;
+  virtual void finish() {}
+  virtual void abort() {}
+  virtual void poll() {}
+};
+
+class CallbackSink : public ResultSink {
+  /** Sink that forwards every result to a user-provided function.
+   **/
+
+public:
+  using Callback =
+      std::function<void(const ToyInfo &, const PrEW::Fit::FitResult &)>;
+
+private:
+  Callback m_callback{};
+
+public:
+  // Constructors
+  CallbackSink(Callback callback);
+
+  void consume(const ToyInfo &info, PrEW::Fit::FitResult result) override;
+};
+
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
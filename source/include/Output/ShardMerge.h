@@ -0,0 +1,37 @@
+#ifndef LIB_SHARDMERGE_H
+#define LIB_SHARDMERGE_H 1
+
+#include <Output/ResultIO.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Output {
+namespace ShardMerge {
+/** Namespace for combining the result files of the shards of a campaign.
+ **/
+
+struct MergeReport {
+  /** Summary of a merge, toy indices are given per energy.
+   **/
+  std::uint64_t m_fingerprint{};
+  std::size_t m_n_results{};
+  std::map<int, std::vector<int>> m_duplicates{};
+  std::map<int, std::vector<int>> m_gaps{};
+
+  bool is_complete() const;
+};
+
+ResultIO::ResultMap merge_files(const std::vector<std::string> &files,
+                                int n_toys, MergeReport *report);
+ResultIO::InfoResultVec flatten(const ResultIO::ResultMap &results);
+
+} // namespace ShardMerge
+} // namespace Output
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef LIB_CANCELTOKEN_H
+#define LIB_CANCELTOKEN_H 1
+
+#include <atomic>
+
+namespace PrEWUtils {
+namespace Parallel {
+
+class CancelToken {
+  /** Flag through which any thread can ask running work to stop.
+      Cancellation is cooperative: work that is already running is completed,
+      work that has not started yet is skipped.
+  **/
+
+  std::atomic<bool> m_cancelled{false};
+
+public:
+  void cancel();
+  bool is_cancelled() const;
+};
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+inline void CancelToken::cancel() {
+  m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+inline bool CancelToken::is_cancelled() const {
+  return m_cancelled.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Parallel
+} // namespace PrEWUtils
+
+#endif
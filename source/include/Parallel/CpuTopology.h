@@ -0,0 +1,34 @@
+#ifndef LIB_CPUTOPOLOGY_H
+#define LIB_CPUTOPOLOGY_H 1
+
+#include <cstddef>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Parallel {
+namespace CpuTopology {
+/** Namespace for placing threads on CPUs and NUMA nodes.
+    The topology is read from Linux sysfs, without it (or on other systems)
+    all CPUs are treated as one node and pinning does nothing.
+ **/
+
+struct Cpu {
+  int m_id{};
+  int m_node{};
+};
+
+// CPUs this process may run on, sorted by NUMA node and CPU id
+std::vector<Cpu> available_cpus();
+int n_nodes();
+int node_of_cpu(int cpu);
+int current_node();
+
+// CPU for each of n_workers, spread evenly over the nodes
+std::vector<int> spread_cpus(std::size_t n_workers);
+bool pin_current_thread(int cpu);
+
+} // namespace CpuTopology
+} // namespace Parallel
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef LIB_FILEWORKQUEUE_H
+#define LIB_FILEWORKQUEUE_H 1
+
+#include <Output/ResultIO.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Parallel {
+
+class FileWorkQueue {
+  /** Queue of toy batches in a directory on a shared filesystem, from which
+      any number of independent processes (e.g. batch jobs on different nodes)
+      pull work without any network service.
+      The campaign is split into batches of consecutive toy indices. A process
+      claims a batch by exclusively creating its claim file, writes the batch
+      results into a result file of the batch and only then drops the claim.
+      Claims that have not been refreshed for longer than the claim timeout
+      are considered left behind by a crashed process and are reclaimed.
+      In rare races a batch may be fitted twice. Each process then writes its
+      own copy of the results and only the first one is published, the toys
+      being deterministic both copies are the same. Claims are only removed
+      or refreshed by the process that holds them.
+  **/
+
+public:
+  struct Batch {
+    /** Consecutive toy indices [m_first_toy, m_last_toy) of one batch.
+     **/
+    int m_index{};
+    int m_first_toy{};
+    int m_last_toy{};
+  };
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  std::string m_directory{};
+  std::uint64_t m_fingerprint{};
+  int m_n_toys{};
+  int m_toys_per_batch{};
+  std::chrono::duration<double> m_claim_timeout{};
+
+  std::string m_owner{}; // Identifies this process in its claim files
+  std::vector<int> m_claimed{};
+  Clock::time_point m_last_heartbeat{};
+
+public:
+  // Constructors
+  FileWorkQueue(const std::string &directory, std::uint64_t fingerprint,
+                int n_toys, int toys_per_batch = 100,
+                std::chrono::duration<double> claim_timeout =
+                    std::chrono::minutes(30));
+
+  FileWorkQueue(const FileWorkQueue &) = delete;
+  FileWorkQueue &operator=(const FileWorkQueue &) = delete;
+
+  // Working on batches
+  bool claim(Batch *batch);
+  void heartbeat();
+  void complete(const Batch &batch,
+                const Output::ResultIO::InfoResultVec &results);
+  void release(const Batch &batch);
+
+  // Access functions
+  std::uint64_t get_fingerprint() const;
+  std::chrono::duration<double> get_claim_timeout() const;
+  int n_batches() const;
+  int n_done() const;
+  bool is_complete() const;
+  std::vector<std::string> result_files() const;
+
+protected:
+  void check_campaign() const;
+  Batch get_batch(int index) const;
+  bool try_claim(int index);
+  bool owns_claim(int index) const;
+  void drop_claim(int index);
+  bool is_done(int index) const;
+  std::string claim_path(int index) const;
+  std::string result_path(int index) const;
+};
+
+} // namespace Parallel
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef LIB_LATCH_H
+#define LIB_LATCH_H 1
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+
+namespace PrEWUtils {
+namespace Parallel {
+
+class Latch {
+  /** Single-use countdown latch signalling the completion of a batch of
+      tasks.
+      A task that failed can hand its exception to the latch, the first such
+      exception is rethrown in the waiting thread.
+  **/
+
+  std::size_t m_count{};
+  std::exception_ptr m_error{};
+
+  std::mutex m_mutex{};
+  std::condition_variable m_done{};
+
+public:
+  // Constructors
+  explicit Latch(std::size_t count);
+
+  Latch(const Latch &) = delete;
+  Latch &operator=(const Latch &) = delete;
+
+  // Signalling
+  void count_down(std::exception_ptr error = nullptr);
+  void wait();
+  template <class Rep, class Period>
+  bool wait_for(const std::chrono::duration<Rep, Period> &timeout);
+  bool is_done();
+};
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+inline Latch::Latch(std::size_t count) : m_count(count) {}
+
+//------------------------------------------------------------------------------
+
+inline void Latch::count_down(std::exception_ptr error) {
+  /** Mark one task as finished, optionally with the exception it threw.
+      Notifies while holding the lock, a waiter may destroy the latch as soon
+      as it sees the count reach zero.
+   **/
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (error && !m_error) {
+    m_error = error;
+  }
+  if (--m_count == 0) {
+    m_done.notify_all();
+  }
+}
+
+inline void Latch::wait() {
+  /** Block until all tasks are finished, rethrow a task exception if any
+      occurred.
+   **/
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this] { return m_count == 0; });
+  if (m_error) {
+    std::rethrow_exception(m_error);
+  }
+}
+
+template <class Rep, class Period>
+bool Latch::wait_for(const std::chrono::duration<Rep, Period> &timeout) {
+  /** Block until all tasks are finished or the timeout passed, return whether
+      all tasks are finished.
+      Rethrows a task exception if all tasks are finished and one occurred.
+   **/
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_done.wait_for(lock, timeout, [this] { return m_count == 0; })) {
+    return false;
+  }
+  if (m_error) {
+    std::rethrow_exception(m_error);
+  }
+  return true;
+}
+
+inline bool Latch::is_done() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_count == 0;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Parallel
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef LIB_WORKSTEALINGPOOL_H
+#define LIB_WORKSTEALINGPOOL_H 1
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Parallel {
+
+class WorkStealingPool {
+  /** Thread pool in which every worker owns its own task deque.
+      Workers take tasks from the back of their own deque and, when it runs
+      empty, steal from the front of the other workers' deques.
+      Tasks enqueued from outside the pool are distributed round-robin, tasks
+      enqueued from within a worker land in that worker's own deque.
+      Idle workers sleep on a condition variable which is only touched when
+      work is submitted while a worker sleeps, so neither busy workers nor
+      submitters contend on a common lock.
+      Provides the same enqueue interface as linx::ThreadPool.
+      An optional init function is run on every worker thread (with the
+      worker index) before it takes any task, e.g. to pin it to a CPU.
+  **/
+
+public:
+  using Task = std::function<void()>;
+  using WorkerInit = std::function<void(int)>;
+
+private:
+  struct WorkerQueue {
+    std::mutex m_mutex{};
+    std::deque<Task> m_tasks{};
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue>> m_queues{};
+  std::vector<std::thread> m_threads{};
+  WorkerInit m_init{};
+
+  std::atomic<std::size_t> m_n_pending{0}; // Queued but not yet started
+  std::atomic<std::size_t> m_next_queue{0};
+  std::atomic<bool> m_stopping{false};
+
+  std::mutex m_sleep_mutex{};
+  std::condition_variable m_wake{};
+  std::atomic<std::size_t> m_n_sleeping{0}; // Workers (about to) wait
+
+public:
+  // Constructors
+  explicit WorkStealingPool(std::size_t n_threads, WorkerInit init = nullptr);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  // Submitting work
+  template <class T> auto enqueue(T task) -> std::future<decltype(task())>;
+  void submit(Task task);
+
+  // Access functions
+  std::size_t size() const;
+  static int current_worker_index();
+
+protected:
+  // Internal functions
+  void start(std::size_t n_threads);
+  void stop() noexcept;
+  void work(int worker_index);
+  bool try_pop(int worker_index, Task *task);
+
+  // Identification of the pool worker running on the current thread
+  static const WorkStealingPool *&thread_pool();
+  static int &thread_worker_index();
+};
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+inline WorkStealingPool::WorkStealingPool(std::size_t n_threads,
+                                          WorkerInit init)
+    : m_init(std::move(init)) {
+  start(n_threads > 0 ? n_threads : 1);
+}
+
+inline WorkStealingPool::~WorkStealingPool() { stop(); }
+
+//------------------------------------------------------------------------------
+
+template <class T>
+auto WorkStealingPool::enqueue(T task) -> std::future<decltype(task())> {
+  /** Queue a task and return a future to its result.
+   **/
+  auto wrapper = std::make_shared<std::packaged_task<decltype(task())()>>(
+      std::move(task));
+  this->submit([wrapper] { (*wrapper)(); });
+  return wrapper->get_future();
+}
+
+inline void WorkStealingPool::submit(Task task) {
+  /** Queue a task without any result handling.
+      The caller is responsible for any synchronisation on its completion.
+   **/
+  std::size_t queue_index{};
+  if (thread_pool() == this) {
+    queue_index = static_cast<std::size_t>(thread_worker_index());
+  } else {
+    queue_index = m_next_queue.fetch_add(1, std::memory_order_relaxed) %
+                  m_queues.size();
+  }
+
+  // Count before pushing so the counter never underflows when the task is
+  // taken right away
+  m_n_pending.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(m_queues[queue_index]->m_mutex);
+    m_queues[queue_index]->m_tasks.push_back(std::move(task));
+  }
+
+  // Sleeping workers announce themselves before checking for pending work,
+  // so either they see the new task or it sees them (both sequentially
+  // consistent). Taking the sleep lock makes sure a worker doesn't miss the
+  // wake-up between checking for pending work and starting to wait.
+  if (m_n_sleeping.load() > 0) {
+    { std::lock_guard<std::mutex> lock(m_sleep_mutex); }
+    m_wake.notify_one();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+inline std::size_t WorkStealingPool::size() const { return m_threads.size(); }
+
+inline int WorkStealingPool::current_worker_index() {
+  /** Index of the pool worker running on the calling thread, -1 if the calling
+      thread is not a pool worker.
+   **/
+  return thread_worker_index();
+}
+
+//------------------------------------------------------------------------------
+
+inline void WorkStealingPool::start(std::size_t n_threads) {
+  for (std::size_t i = 0; i < n_threads; i++) {
+    m_queues.push_back(std::make_unique<WorkerQueue>());
+  }
+  for (std::size_t i = 0; i < n_threads; i++) {
+    m_threads.emplace_back([this, i] { this->work(static_cast<int>(i)); });
+  }
+}
+
+inline void WorkStealingPool::stop() noexcept {
+  /** Let the workers finish all queued tasks, then join them.
+   **/
+  {
+    std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+inline void WorkStealingPool::work(int worker_index) {
+  /** Main loop of a single worker.
+   **/
+  thread_pool() = this;
+  thread_worker_index() = worker_index;
+  if (m_init) {
+    m_init(worker_index);
+  }
+
+  while (true) {
+    Task task{};
+    if (this->try_pop(worker_index, &task)) {
+      task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+    m_n_sleeping.fetch_add(1);
+    m_wake.wait(lock, [this] { return m_stopping || m_n_pending > 0; });
+    m_n_sleeping.fetch_sub(1);
+    if (m_stopping && m_n_pending == 0) {
+      break;
+    }
+  }
+}
+
+inline bool WorkStealingPool::try_pop(int worker_index, Task *task) {
+  /** Try to take a task, first from the back of the own queue, then from the
+      front of the other queues.
+   **/
+  std::size_t n_queues = m_queues.size();
+  for (std::size_t offset = 0; offset < n_queues; offset++) {
+    auto &queue = *m_queues[(static_cast<std::size_t>(worker_index) + offset) %
+                            n_queues];
+    std::lock_guard<std::mutex> lock(queue.m_mutex);
+    if (queue.m_tasks.empty()) {
+      continue;
+    }
+    if (offset == 0) {
+      *task = std::move(queue.m_tasks.back());
+      queue.m_tasks.pop_back();
+    } else {
+      *task = std::move(queue.m_tasks.front());
+      queue.m_tasks.pop_front();
+    }
+    m_n_pending.fetch_sub(1);
+    return true;
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+inline const WorkStealingPool *&WorkStealingPool::thread_pool() {
+  thread_local const WorkStealingPool *pool{nullptr};
+  return pool;
+}
+
+inline int &WorkStealingPool::thread_worker_index() {
+  thread_local int worker_index{-1};
+  return worker_index;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Parallel
+} // namespace PrEWUtils
+
+#endif
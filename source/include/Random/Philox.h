@@ -0,0 +1,126 @@
+#ifndef LIB_PHILOX_H
+#define LIB_PHILOX_H 1
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace PrEWUtils {
+namespace Random {
+
+class Philox {
+  /** Counter-based Philox4x32-10 random number generator
+      (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11).
+      Every output block is a pure function of (key, counter), so a stream is
+      fully determined by its key and the fixed upper counter words.
+      There is no shared state, each user simply constructs its own stream.
+      Satisfies the UniformRandomBitGenerator requirements and can be used with
+      the standard library distributions.
+  **/
+
+public:
+  using result_type = std::uint32_t;
+  using Block = std::array<std::uint32_t, 4>;
+  using Key = std::array<std::uint32_t, 2>;
+
+private:
+  Key m_key{};
+  Block m_counter{}; // Word 0 counts blocks, words 1-3 identify the stream
+  Block m_block{};
+  int m_n_used{4}; // Values of current block already handed out
+
+public:
+  // Constructors
+  Philox(std::uint64_t key, std::uint32_t stream_1, std::uint32_t stream_2,
+         std::uint32_t stream_3);
+
+  // Generator interface
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+  result_type operator()();
+
+  // Raw block function
+  static constexpr Block generate_block(Block counter, Key key);
+};
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+inline Philox::Philox(std::uint64_t key, std::uint32_t stream_1,
+                      std::uint32_t stream_2, std::uint32_t stream_3)
+    : m_key{{static_cast<std::uint32_t>(key),
+             static_cast<std::uint32_t>(key >> 32)}},
+      m_counter{{0, stream_1, stream_2, stream_3}} {}
+
+//------------------------------------------------------------------------------
+
+inline Philox::result_type Philox::operator()() {
+  if (m_n_used == 4) {
+    m_block = generate_block(m_counter, m_key);
+    m_counter[0]++;
+    m_n_used = 0;
+  }
+  return m_block[static_cast<std::size_t>(m_n_used++)];
+}
+
+//------------------------------------------------------------------------------
+
+constexpr Philox::Block Philox::generate_block(Block counter, Key key) {
+  /** Ten Philox rounds on the given counter with the given key.
+   **/
+  constexpr std::uint64_t mult_0 = 0xD2511F53;
+  constexpr std::uint64_t mult_1 = 0xCD9E8D57;
+  constexpr std::uint32_t weyl_0 = 0x9E3779B9;
+  constexpr std::uint32_t weyl_1 = 0xBB67AE85;
+
+  for (int round = 0; round < 10; round++) {
+    std::uint64_t prod_0 = mult_0 * counter[0];
+    std::uint64_t prod_1 = mult_1 * counter[2];
+    counter = {{static_cast<std::uint32_t>(prod_1 >> 32) ^ counter[1] ^ key[0],
+                static_cast<std::uint32_t>(prod_1),
+                static_cast<std::uint32_t>(prod_0 >> 32) ^ counter[3] ^ key[1],
+                static_cast<std::uint32_t>(prod_0)}};
+    key[0] += weyl_0;
+    key[1] += weyl_1;
+  }
+  return counter;
+}
+
+//------------------------------------------------------------------------------
+// Known-answer check
+//------------------------------------------------------------------------------
+
+namespace PhiloxCheck {
+/** Known-answer vectors of Philox4x32-10 from the Random123 distribution
+    (kat_vectors), checked at compile time. Toy streams must never change,
+    checkpoints, shards and reruns of single toys rely on them.
+ **/
+constexpr bool matches(Philox::Block counter, Philox::Key key,
+                       Philox::Block expected) {
+  auto block = Philox::generate_block(counter, key);
+  return (block[0] == expected[0]) && (block[1] == expected[1]) &&
+         (block[2] == expected[2]) && (block[3] == expected[3]);
+}
+
+static_assert(matches({{0, 0, 0, 0}}, {{0, 0}},
+                      {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}}),
+              "Philox: Known-answer check failed for zero input.");
+static_assert(matches({{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}},
+                      {{0xffffffff, 0xffffffff}},
+                      {{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}}),
+              "Philox: Known-answer check failed for all-ones input.");
+static_assert(matches({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}},
+                      {{0xa4093822, 0x299f31d0}},
+                      {{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}}),
+              "Philox: Known-answer check failed for pi input.");
+} // namespace PhiloxCheck
+
+//------------------------------------------------------------------------------
+
+} // namespace Random
+} // namespace PrEWUtils
+
+#endif
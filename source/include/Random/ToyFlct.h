@@ -0,0 +1,37 @@
+#ifndef LIB_TOYFLCT_H
+#define LIB_TOYFLCT_H 1
+
+#include <Random/Philox.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Random {
+
+namespace ToyFlct {
+/** Reproducible fluctuation of toy measurements.
+    Every toy draws from its own counter-based random streams, keyed by the
+    campaign seed and identified by energy, toy index and what is fluctuated.
+    A toy therefore only depends on the seed and its index, not on which
+    thread or job generates it or how many toys were generated before.
+ **/
+
+// Stream domains, separate streams keep measurement and constraint
+// fluctuations independent of each other's number of draws
+enum class Domain : std::uint32_t { Measurement = 0, Constraints = 1 };
+
+Philox toy_stream(std::uint64_t campaign_seed, int energy, int toy_index,
+                  Domain domain);
+
+void fluctuate_bins(const std::vector<double> &expected,
+                    std::vector<double> *measured, Philox &rng);
+
+double fluctuate_constr(double val, double unc, Philox &rng);
+
+} // namespace ToyFlct
+
+} // namespace Random
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef LIB_BATCHRUNNER_H
+#define LIB_BATCHRUNNER_H 1
+
+#include <Parallel/WorkStealingPool.h>
+#include <Runners/ParallelRunner.h>
+
+// Includes from PrEW
+#include "Fit/FitResult.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Runners {
+
+  struct BatchJobOptions {
+    /** Scheduling of a job in a batch.
+        Jobs of higher priority get all free workers before any job of lower
+        priority is started. Jobs of the same priority share the workers in
+        proportion to their weights (in toys started).
+    **/
+    int m_priority {0};
+    double m_weight {1.0};
+  };
+
+  //----------------------------------------------------------------------------
+
+  template <class SetupClass, class Policy = Policies::DefaultPolicy>
+  class BatchRunner {
+    /** Runs the toy fits of many setups (e.g. variants of a GeneralSetup with
+        different distributions or systematics) on a single persistent thread
+        pool.
+        Each job is a setup with its own minimizers and number of toys. The
+        toy chunks of all jobs are dealt out to the pool from one scheduler
+        that keeps a fixed number of chunks in flight, so the workers move on
+        to the next job while the last toys of the previous one finish.
+        Every job is a full ParallelRunner, its toys are identical to those of
+        a standalone run with the same options. Options concerning the run
+        itself (checkpointing, sinks, stopping policies, worker pinning) are
+        not used by the batch.
+    **/
+
+    public:
+      using Runner = ParallelRunner<SetupClass, Policy>;
+      using JobID = std::size_t;
+      using JobResults = std::map<int, PrEW::Fit::ResultVec>; // Per energy
+      using JobHandler = std::function<void(JobID, JobResults &&)>;
+
+    private:
+      class Job : public Runner {
+        /** Runner of a single job with the scheduling state of its toys.
+        **/
+        public:
+          using ToyChunk = typename Runner::ToyChunk;
+          using EnergyChunk = std::pair<int, ToyChunk>;
+
+          Job(
+            const SetupClass & setup,
+            const std::string & minuit_minimizers,
+            const std::string & prew_minimizer,
+            int n_toys,
+            const BatchJobOptions & options
+          );
+
+          void prepare(std::size_t n_workers);
+          bool has_pending() const;
+          bool is_finished() const;
+          void submit_next(
+            Parallel::WorkStealingPool * pool,
+            const std::function<void(std::exception_ptr)> & on_chunk_done
+          );
+          void chunk_done();
+          JobResults finish();
+
+          std::vector<int> m_energies {};
+          int m_n_toys {};
+          BatchJobOptions m_options {};
+          std::size_t m_n_started {0}; // Toys handed to the pool
+
+        private:
+          std::vector<EnergyChunk> m_chunks {}; // Energies interleaved
+          std::size_t m_next_chunk {0};
+          std::size_t m_n_running {0};
+          ToyTiming::Clock::time_point m_start {};
+
+          int m_first_toy {0}; // First toy of the shard
+          JobResults m_results {};
+          std::map<int, std::vector<char>> m_finished {};
+          std::vector<typename Runner::WorkerWorkspaces> m_workspaces {};
+      };
+
+      std::unique_ptr<Parallel::WorkStealingPool> m_own_pool {};
+      Parallel::WorkStealingPool * m_pool {nullptr};
+      std::vector<std::unique_ptr<Job>> m_jobs {}; // Index is the job ID
+      std::size_t m_next_job {0}; // First job not run yet
+
+      // Scheduler state, shared with the workers finishing chunks
+      std::mutex m_mutex {};
+      std::condition_variable m_chunk_done {};
+      std::vector<JobID> m_done_chunks {};
+      std::exception_ptr m_error {};
+
+    public:
+      // Constructors
+      explicit BatchRunner(int n_threads);
+      explicit BatchRunner(Parallel::WorkStealingPool * pool);
+
+      BatchRunner(const BatchRunner &) = delete;
+      BatchRunner & operator=(const BatchRunner &) = delete;
+
+      // Adding jobs
+      JobID add_job(
+        const SetupClass & setup,
+        const std::string & minuit_minimizers,
+        const std::string & prew_minimizer,
+        int n_toys,
+        const BatchJobOptions & options = {}
+      );
+      Runner & get_runner(JobID job);
+
+      // Running all jobs added since the last run
+      void run(const JobHandler & handler);
+      std::map<JobID, JobResults> run();
+
+      // Access functions
+      std::size_t get_n_workers() const;
+
+    protected:
+      // Internal functions
+      std::size_t max_in_flight() const;
+      bool next_job(const std::vector<JobID> & active, JobID * next) const;
+  };
+
+} // Namespace Runners
+} // Namespace PrEWUtils
+
+// Since the above is a template class the function definition has to happen
+// either in the header itself or in a template file in the include directory
+#include <Runners/BatchRunner.tpp>
+
+#endif
@@ -0,0 +1,389 @@
+#ifndef LIB_BATCHRUNNER_TPP
+#define LIB_BATCHRUNNER_TPP 1
+
+#include <Runners/BatchRunner.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace PrEWUtils {
+namespace Runners {
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+BatchRunner<SetupClass, Policy>::BatchRunner(int n_threads)
+    : m_own_pool(std::make_unique<Parallel::WorkStealingPool>(
+          static_cast<std::size_t>(std::max(n_threads, 1)))),
+      m_pool(m_own_pool.get()) {}
+
+template <class SetupClass, class Policy>
+BatchRunner<SetupClass, Policy>::BatchRunner(Parallel::WorkStealingPool *pool)
+    : m_pool(pool) {
+  /** Use an existing pool, which must outlive the batch runner.
+   **/
+  if (!m_pool) {
+    throw std::invalid_argument("BatchRunner: No thread pool given!");
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+typename BatchRunner<SetupClass, Policy>::JobID
+BatchRunner<SetupClass, Policy>::add_job(const SetupClass &setup,
+                                         const std::string &minuit_minimizers,
+                                         const std::string &prew_minimizer,
+                                         int n_toys,
+                                         const BatchJobOptions &options) {
+  /** Add a job running the given number of toys at every energy of the setup.
+      Returns the ID under which the results are delivered.
+      Jobs can also be added from within the handler of a running batch, they
+      are then scheduled as part of that batch.
+   **/
+  if (n_toys < 0) {
+    throw std::invalid_argument("BatchRunner: Negative number of toys " +
+                                std::to_string(n_toys));
+  }
+  if (!(options.m_weight > 0)) {
+    throw std::invalid_argument("BatchRunner: Job weight must be positive!");
+  }
+  m_jobs.push_back(std::make_unique<Job>(setup, minuit_minimizers,
+                                         prew_minimizer, n_toys, options));
+  spdlog::debug("BatchRunner: Added job {} with {} toys.", m_jobs.size() - 1,
+                n_toys);
+  return m_jobs.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+typename BatchRunner<SetupClass, Policy>::Runner &
+BatchRunner<SetupClass, Policy>::get_runner(JobID job) {
+  /** Runner of the job, to set its options (seed, bin selector, fit
+      modifications, ...) before the job is run.
+   **/
+  if (job >= m_jobs.size()) {
+    throw std::out_of_range("BatchRunner: Unknown job " + std::to_string(job));
+  }
+  return *(m_jobs[job]);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void BatchRunner<SetupClass, Policy>::run(const JobHandler &handler) {
+  /** Run all jobs added since the last run and hand the results of each job
+      to the handler as soon as the job is finished.
+      The handler is called on the calling thread while the pool keeps working
+      on the other jobs.
+      If a toy fit throws no further chunks are started, the running ones are
+      finished and the exception is rethrown. Jobs not delivered by then are
+      dropped.
+   **/
+  std::vector<JobID> active{};
+  auto add_new_jobs = [this, &active] {
+    for (; m_next_job < m_jobs.size(); m_next_job++) {
+      m_jobs[m_next_job]->prepare(m_pool->size());
+      active.push_back(m_next_job);
+    }
+  };
+  auto has_error = [this] {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<bool>(m_error);
+  };
+
+  std::size_t n_in_flight = 0;
+  auto wait_for_chunks = [this, &n_in_flight] {
+    std::vector<JobID> done{};
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_chunk_done.wait(lock, [this] { return !m_done_chunks.empty(); });
+      done.swap(m_done_chunks);
+    }
+    n_in_flight -= done.size();
+    for (const auto &job : done) {
+      m_jobs[job]->chunk_done();
+    }
+  };
+
+  try {
+    add_new_jobs();
+    spdlog::info("BatchRunner: Running {} jobs on {} workers.", active.size(),
+                 m_pool->size());
+    while (true) {
+      if (!has_error()) {
+        // Deliver finished jobs, the handler may add new ones
+        for (std::size_t a = 0; a < active.size();) {
+          auto job = active[a];
+          if (!m_jobs[job]->is_finished()) {
+            a++;
+            continue;
+          }
+          active.erase(active.begin() + static_cast<long>(a));
+          spdlog::debug("BatchRunner: Job {} finished.", job);
+          handler(job, m_jobs[job]->finish());
+        }
+        add_new_jobs();
+
+        JobID job_id{};
+        while ((n_in_flight < this->max_in_flight()) &&
+               this->next_job(active, &job_id)) {
+          auto *job = m_jobs[job_id].get();
+          job->submit_next(m_pool, [this, job_id](std::exception_ptr error) {
+            // Notify under the lock, the runner may be gone right after
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (error && !m_error) {
+              m_error = error;
+            }
+            m_done_chunks.push_back(job_id);
+            m_chunk_done.notify_one();
+          });
+          n_in_flight++;
+        }
+      }
+      if (n_in_flight == 0) {
+        break;
+      }
+      wait_for_chunks();
+    }
+  } catch (...) {
+    // Don't leave tasks behind that reference the jobs
+    while (n_in_flight > 0) {
+      wait_for_chunks();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_error = nullptr;
+    throw;
+  }
+
+  std::exception_ptr error{};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::swap(error, m_error);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  spdlog::info("BatchRunner: All jobs finished.");
+}
+
+template <class SetupClass, class Policy>
+std::map<typename BatchRunner<SetupClass, Policy>::JobID,
+         typename BatchRunner<SetupClass, Policy>::JobResults>
+BatchRunner<SetupClass, Policy>::run() {
+  /** Run all jobs added since the last run and return the results of each
+      job, by energy and toy index.
+   **/
+  std::map<JobID, JobResults> results{};
+  this->run([&results](JobID job, JobResults &&job_results) {
+    results[job] = std::move(job_results);
+  });
+  return results;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+std::size_t BatchRunner<SetupClass, Policy>::get_n_workers() const {
+  return m_pool->size();
+}
+
+//------------------------------------------------------------------------------
+// Internal functions
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+std::size_t BatchRunner<SetupClass, Policy>::max_in_flight() const {
+  /** Chunks kept on the pool at once: enough that no worker runs dry while
+      the scheduler reacts, few enough that priorities take effect quickly.
+   **/
+  return 2 * m_pool->size();
+}
+
+template <class SetupClass, class Policy>
+bool BatchRunner<SetupClass, Policy>::next_job(
+    const std::vector<JobID> &active, JobID *next) const {
+  /** Find the job whose next chunk is started: among the jobs of the highest
+      priority with chunks left the one with the fewest started toys per
+      weight.
+      Returns false if no chunk is left.
+   **/
+  const Job *next_job = nullptr;
+  for (const auto &job_id : active) {
+    const auto *job = m_jobs[job_id].get();
+    if (!job->has_pending()) {
+      continue;
+    }
+    bool is_next =
+        !next_job ||
+        (job->m_options.m_priority > next_job->m_options.m_priority) ||
+        ((job->m_options.m_priority == next_job->m_options.m_priority) &&
+         (static_cast<double>(job->m_n_started) / job->m_options.m_weight <
+          static_cast<double>(next_job->m_n_started) /
+              next_job->m_options.m_weight));
+    if (is_next) {
+      next_job = job;
+      *next = job_id;
+    }
+  }
+  return next_job != nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Jobs
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+BatchRunner<SetupClass, Policy>::Job::Job(const SetupClass &setup,
+                                          const std::string &minuit_minimizers,
+                                          const std::string &prew_minimizer,
+                                          int n_toys,
+                                          const BatchJobOptions &options)
+    : Runner(setup, minuit_minimizers, prew_minimizer),
+      m_energies(setup.get_energies()), m_n_toys(n_toys), m_options(options) {}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void BatchRunner<SetupClass, Policy>::Job::prepare(std::size_t n_workers) {
+  /** Split the toys (of this runner's shard) into chunks and preallocate the
+      results.
+      The chunks of the energies are interleaved, so all energies progress
+      together.
+   **/
+  auto shard_toys = this->get_shard_toys(m_n_toys);
+  auto n_shard_toys = shard_toys.second - shard_toys.first;
+  m_first_toy = shard_toys.first;
+
+  m_chunks.clear();
+  for (const auto &chunk : this->get_toy_chunks(n_shard_toys, n_workers)) {
+    for (const auto &energy : m_energies) {
+      m_chunks.push_back({energy,
+                          {m_first_toy + chunk.first,
+                           m_first_toy + chunk.second}});
+    }
+  }
+  m_next_chunk = 0;
+  m_n_running = 0;
+  m_n_started = 0;
+
+  m_results.clear();
+  m_finished.clear();
+  for (const auto &energy : m_energies) {
+    m_results[energy] = PrEW::Fit::ResultVec(n_shard_toys);
+    m_finished[energy] = std::vector<char>(n_shard_toys, false);
+  }
+  m_workspaces = std::vector<typename Runner::WorkerWorkspaces>(n_workers);
+  m_start = ToyTiming::Clock::now();
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+bool BatchRunner<SetupClass, Policy>::Job::has_pending() const {
+  return m_next_chunk < m_chunks.size();
+}
+
+template <class SetupClass, class Policy>
+bool BatchRunner<SetupClass, Policy>::Job::is_finished() const {
+  return !this->has_pending() && (m_n_running == 0);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void BatchRunner<SetupClass, Policy>::Job::submit_next(
+    Parallel::WorkStealingPool *pool,
+    const std::function<void(std::exception_ptr)> &on_chunk_done) {
+  /** Queue a task fitting the toys of the next chunk in the workspace of the
+      executing worker.
+      Toys that have not started when the runner's cancel token is cancelled
+      are skipped.
+      The callback is called from the worker once the chunk is done, with the
+      exception if one was thrown.
+   **/
+  auto energy = m_chunks[m_next_chunk].first;
+  auto chunk = m_chunks[m_next_chunk].second;
+  m_next_chunk++;
+  m_n_running++;
+  m_n_started += static_cast<std::size_t>(chunk.second - chunk.first);
+
+  ToyTiming::Clock::time_point submitted{};
+  if (ToyTiming::enabled) {
+    submitted = ToyTiming::Clock::now();
+  }
+  pool->submit([this, energy, chunk, on_chunk_done, submitted] {
+    std::exception_ptr error{};
+    try {
+      auto worker = Parallel::WorkStealingPool::current_worker_index();
+      auto *workspace = this->get_workspace(
+          energy, &m_workspaces.at(static_cast<std::size_t>(worker)));
+      if (ToyTiming::enabled) {
+        workspace->get_timings()->add(ToyTiming::QueueWait,
+                                      ToyTiming::Clock::now() - submitted);
+      }
+      auto &results = m_results.at(energy);
+      auto &finished = m_finished.at(energy);
+      for (int t = chunk.first; t < chunk.second; t++) {
+        if (this->is_cancelled()) {
+          break;
+        }
+        auto index = static_cast<std::size_t>(t - m_first_toy);
+        results[index] = this->single_fit_task(energy, t, workspace);
+        finished[index] = true;
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+    on_chunk_done(error);
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void BatchRunner<SetupClass, Policy>::Job::chunk_done() {
+  m_n_running--;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+typename BatchRunner<SetupClass, Policy>::JobResults
+BatchRunner<SetupClass, Policy>::Job::finish() {
+  /** Results of the finished job, without the toys skipped on cancellation.
+      Releases the workspaces of the job.
+   **/
+  this->report_timing(m_workspaces, m_start);
+  m_workspaces.clear();
+
+  if (this->is_cancelled()) {
+    for (auto &energy_results : m_results) {
+      const auto &finished = m_finished.at(energy_results.first);
+      PrEW::Fit::ResultVec finished_results{};
+      for (std::size_t t = 0; t < finished.size(); t++) {
+        if (finished[t]) {
+          finished_results.push_back(std::move(energy_results.second[t]));
+        }
+      }
+      spdlog::warn("BatchRunner: Job cancelled, returning {} of {} toys @ "
+                   "E={}.",
+                   finished_results.size(), finished.size(),
+                   energy_results.first);
+      energy_results.second = std::move(finished_results);
+    }
+  }
+  m_finished.clear();
+  return std::move(m_results);
+}
+
+//------------------------------------------------------------------------------
+
+} // Namespace Runners
+} // Namespace PrEWUtils
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef LIB_LIKELIHOODSCAN_H
+#define LIB_LIKELIHOODSCAN_H 1
+
+#include <Runners/ParallelRunner.h>
+
+// Includes from PrEW
+#include "Fit/FitResult.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Runners {
+
+  struct ScanAxis {
+    /** Scanned parameter and its uniform (coarse) grid of n_points values
+        between m_min and m_max.
+    **/
+    std::string m_par_name {};
+    double m_min {};
+    double m_max {};
+    int m_n_points {2};
+  };
+
+  using ScanAxes = std::vector<ScanAxis>;
+
+  struct ScanRefinement {
+    /** Adaptive refinement of a scan grid.
+        In each of the n_refinements steps every grid cell whose corners lie
+        on both sides of one of the levels (in FCN units above the best fit,
+        e.g. 2.30 and 6.18 for the 68% and 95% contours of a chi-squared in
+        2D) is split in half along every axis.
+    **/
+    std::vector<double> m_levels {};
+    int m_n_refinements {3};
+  };
+
+  struct ScanPoint {
+    /** Profiled fit with the scanned parameters fixed to the scan values.
+    **/
+    std::vector<double> m_scan_vals {}; // Ordered like the scan axes
+    double m_delta_fcn {}; // FCN minimum above the best fit
+    PrEW::Fit::FitResult m_result {};
+  };
+
+  struct ScanResult {
+    /** Minimum-FCN surface of a scan, points ordered lexicographically in the
+        scan values.
+    **/
+    std::vector<std::string> m_par_names {};
+    PrEW::Fit::FitResult m_best_fit {};
+    std::vector<ScanPoint> m_points {};
+  };
+
+  //----------------------------------------------------------------------------
+
+  template <class SetupClass, class Policy = Policies::DefaultPolicy>
+  class LikelihoodScan : protected ParallelRunner<SetupClass, Policy> {
+    /** Profile-likelihood scans of the Asimov dataset over a grid of one or
+        more (usually one or two) parameters, e.g. TGC contours in Delta-g1Z
+        vs. Delta-kappa_gamma.
+        Every grid point is a fit of all other parameters with the scanned
+        ones fixed. The points are fitted in parallel on the thread pool in
+        waves moving outwards from the best fit, each point starts from the
+        minimum of an already fitted neighbour.
+        Uses the setup, minimizers, bin selection and fit modifications
+        exactly like the ParallelRunner with the same arguments.
+        The result policy must keep the FCN minimum and the final parameters
+        (as the default FullResult does).
+    **/
+
+    using Runner = ParallelRunner<SetupClass, Policy>;
+    using Workspaces = std::vector<typename Runner::WorkerWorkspaces>;
+    using Lattice = std::vector<long>; // Integer coordinates of a grid point
+
+    struct ScanState {
+      /** Grid points of a single scan.
+          A coarse grid step is m_step lattice units, each refinement halves
+          the step.
+      **/
+      int m_energy {};
+      ScanAxes m_axes {};
+      std::vector<std::size_t> m_par_indices {};
+      long m_step {1};
+      PrEW::Fit::FitResult m_best_fit {};
+      std::map<Lattice, ScanPoint> m_points {};
+    };
+
+    public:
+      // Constructors
+      LikelihoodScan(
+        const SetupClass & setup,
+        const std::string & minuit_minimizers,
+        const std::string & prew_minimizer
+      );
+
+      // Options shared with the ParallelRunner
+      using Runner::set_bin_selector;
+      using Runner::modify_fit;
+      using Runner::set_toy_budget;
+      using Runner::set_cancel_token;
+      using Runner::set_worker_pinning;
+      using Runner::get_data_connector;
+      using Runner::get_pars;
+
+      // Running scans
+      ScanResult scan(
+        int energy,
+        const ScanAxes & axes,
+        int n_threads
+      ) const;
+
+      ScanResult scan(
+        int energy,
+        const ScanAxes & axes,
+        const ScanRefinement & refinement,
+        int n_threads
+      ) const;
+
+    protected:
+      // Internal functions
+      ScanState init_state(
+        int energy,
+        const ScanAxes & axes,
+        int n_refinements
+      ) const;
+      PrEW::Fit::FitResult fit_best(int energy) const;
+
+      void fit_coarse_grid(
+        ScanState * state,
+        Parallel::WorkStealingPool * pool,
+        Workspaces * workspaces
+      ) const;
+      void refine(
+        ScanState * state,
+        const ScanRefinement & refinement,
+        Parallel::WorkStealingPool * pool,
+        Workspaces * workspaces
+      ) const;
+
+      using StartMap = std::map<Lattice, Lattice>; // Point -> start point
+      void fit_wave(
+        const StartMap & wave,
+        ScanState * state,
+        Parallel::WorkStealingPool * pool,
+        Workspaces * workspaces
+      ) const;
+      ScanPoint fit_point(
+        const ScanState & state,
+        const Lattice & point,
+        const PrEW::Fit::FitResult & start,
+        ToyWorkspace * workspace
+      ) const;
+
+      std::vector<double> scan_vals(
+        const ScanState & state,
+        const Lattice & point
+      ) const;
+      bool crosses_level(
+        const ScanState & state,
+        const Lattice & corner,
+        long size,
+        const std::vector<double> & levels
+      ) const;
+      ScanResult collect(const ScanState & state) const;
+  };
+
+} // Namespace Runners
+} // Namespace PrEWUtils
+
+// Since the above is a template class the function definition has to happen
+// either in the header itself or in a template file in the include directory
+#include <Runners/LikelihoodScan.tpp>
+
+#endif
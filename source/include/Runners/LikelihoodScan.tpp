@@ -0,0 +1,425 @@
+#ifndef LIB_LIKELIHOODSCAN_TPP
+#define LIB_LIKELIHOODSCAN_TPP 1
+
+#include <Runners/LikelihoodScan.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Runners {
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+LikelihoodScan<SetupClass, Policy>::LikelihoodScan(
+    const SetupClass &setup, const std::string &minuit_minimizers,
+    const std::string &prew_minimizer)
+    : Runner(setup, minuit_minimizers, prew_minimizer) {}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+ScanResult LikelihoodScan<SetupClass, Policy>::scan(int energy,
+                                                    const ScanAxes &axes,
+                                                    int n_threads) const {
+  /** Scan the uniform grid given by the axes.
+   **/
+  return this->scan(energy, axes, ScanRefinement{{}, 0}, n_threads);
+}
+
+template <class SetupClass, class Policy>
+ScanResult LikelihoodScan<SetupClass, Policy>::scan(
+    int energy, const ScanAxes &axes, const ScanRefinement &refinement,
+    int n_threads) const {
+  /** Scan the grid given by the axes and refine it around the contour levels.
+      Points whose fit was skipped because the scan was cancelled are missing
+      from the result.
+   **/
+  auto state = this->init_state(energy, axes, refinement.m_n_refinements);
+
+  auto pool = this->make_pool(n_threads);
+  Workspaces workspaces(pool->size());
+  this->fit_coarse_grid(&state, pool.get(), &workspaces);
+  if (!refinement.m_levels.empty()) {
+    this->refine(&state, refinement, pool.get(), &workspaces);
+  }
+
+  spdlog::info("LikelihoodScan: Scan @ E={} finished with {} points.", energy,
+               state.m_points.size());
+  return this->collect(state);
+}
+
+//------------------------------------------------------------------------------
+// Internal functions
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+typename LikelihoodScan<SetupClass, Policy>::ScanState
+LikelihoodScan<SetupClass, Policy>::init_state(int energy,
+                                               const ScanAxes &axes,
+                                               int n_refinements) const {
+  /** Check the scan request, resolve the scanned parameters and fit the best
+      fit from which the scan starts.
+   **/
+  if (!this->has_energy(energy)) {
+    throw std::invalid_argument("LikelihoodScan: Energy not available " +
+                                std::to_string(energy));
+  }
+  if (axes.empty()) {
+    throw std::invalid_argument("LikelihoodScan: No parameters to scan!");
+  }
+  if ((n_refinements < 0) || (n_refinements > 20)) {
+    throw std::invalid_argument("LikelihoodScan: Invalid number of "
+                                "refinements " +
+                                std::to_string(n_refinements));
+  }
+
+  ScanState state{};
+  state.m_energy = energy;
+  state.m_axes = axes;
+  state.m_step = 1L << n_refinements;
+
+  const auto &pars = this->get_pars(energy);
+  for (const auto &axis : axes) {
+    if ((axis.m_n_points < 2) || !(axis.m_max > axis.m_min)) {
+      throw std::invalid_argument("LikelihoodScan: Invalid axis of " +
+                                  axis.m_par_name);
+    }
+    auto par_it = std::find_if(pars.begin(), pars.end(),
+                               [&axis](const PrEW::Fit::FitPar &par) {
+                                 return par.get_name() == axis.m_par_name;
+                               });
+    if (par_it == pars.end()) {
+      throw std::invalid_argument("LikelihoodScan: Unknown parameter " +
+                                  axis.m_par_name);
+    }
+    state.m_par_indices.push_back(
+        static_cast<std::size_t>(std::distance(pars.begin(), par_it)));
+  }
+
+  state.m_best_fit = this->fit_best(energy);
+  return state;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+PrEW::Fit::FitResult
+LikelihoodScan<SetupClass, Policy>::fit_best(int energy) const {
+  /** Unconstrained fit of the Asimov dataset on the calling thread.
+   **/
+  spdlog::debug("LikelihoodScan: Fitting Asimov dataset @ E={}.", energy);
+  typename Runner::WorkerWorkspaces workspaces{};
+  auto *workspace = this->get_workspace(energy, &workspaces);
+  return this->minimize_chain(workspace->prepare_asimov(), workspace);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void LikelihoodScan<SetupClass, Policy>::fit_coarse_grid(
+    ScanState *state, Parallel::WorkStealingPool *pool,
+    Workspaces *workspaces) const {
+  /** Fit the coarse grid in waves of growing (Manhattan) distance from the
+      grid point closest to the best fit.
+      Each point starts from a neighbour one step closer, which belongs to the
+      previous wave. The closest point itself starts from the best fit.
+   **/
+  const auto &axes = state->m_axes;
+  auto n_axes = axes.size();
+
+  std::vector<long> seed(n_axes);
+  for (std::size_t a = 0; a < n_axes; a++) {
+    const auto &axis = axes[a];
+    double width = (axis.m_max - axis.m_min) / (axis.m_n_points - 1);
+    double best_val = state->m_best_fit.m_pars_fin.at(state->m_par_indices[a]);
+    auto index = std::lround((best_val - axis.m_min) / width);
+    seed[a] = std::max(0L, std::min(index, long{axis.m_n_points - 1}));
+  }
+
+  std::map<long, StartMap> waves{};
+  std::vector<long> index(n_axes, 0);
+  while (true) {
+    long distance = 0;
+    Lattice point(n_axes), start(n_axes);
+    bool start_set = false;
+    for (std::size_t a = 0; a < n_axes; a++) {
+      distance += std::abs(index[a] - seed[a]);
+      point[a] = index[a] * state->m_step;
+      start[a] = point[a];
+      if (!start_set && (index[a] != seed[a])) {
+        start[a] += (index[a] < seed[a] ? 1 : -1) * state->m_step;
+        start_set = true;
+      }
+    }
+    waves[distance][point] = start_set ? start : Lattice{};
+
+    // Next grid index
+    std::size_t a = 0;
+    while ((a < n_axes) && (++index[a] == axes[a].m_n_points)) {
+      index[a] = 0;
+      a++;
+    }
+    if (a == n_axes) {
+      break;
+    }
+  }
+
+  for (const auto &wave : waves) {
+    spdlog::debug("LikelihoodScan: Fitting {} points at distance {}.",
+                  wave.second.size(), wave.first);
+    this->fit_wave(wave.second, state, pool, workspaces);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void LikelihoodScan<SetupClass, Policy>::refine(
+    ScanState *state, const ScanRefinement &refinement,
+    Parallel::WorkStealingPool *pool, Workspaces *workspaces) const {
+  /** Split the cells crossing a contour level and fit the new points, in as
+      many steps as there are refinements.
+      The new points of a step are fitted in a single wave, each starting from
+      the nearest corner of the split cell.
+   **/
+  auto n_axes = state->m_axes.size();
+  auto n_sub_points = static_cast<std::size_t>(std::pow(3, n_axes));
+  auto n_sub_cells = std::size_t{1} << n_axes;
+
+  // Start with all cells of the coarse grid (given by their lower corner)
+  std::vector<Lattice> cells{};
+  std::vector<long> index(n_axes, 0);
+  while (true) {
+    Lattice cell(n_axes);
+    for (std::size_t a = 0; a < n_axes; a++) {
+      cell[a] = index[a] * state->m_step;
+    }
+    cells.push_back(cell);
+
+    std::size_t a = 0;
+    while ((a < n_axes) && (++index[a] == state->m_axes[a].m_n_points - 1)) {
+      index[a] = 0;
+      a++;
+    }
+    if (a == n_axes) {
+      break;
+    }
+  }
+
+  for (int r = 0; r < refinement.m_n_refinements; r++) {
+    long size = state->m_step >> r;
+    long half = size / 2;
+
+    StartMap wave{};
+    std::vector<Lattice> split_cells{};
+    for (const auto &cell : cells) {
+      if (!this->crosses_level(*state, cell, size, refinement.m_levels)) {
+        continue;
+      }
+      // All points of the 3x3(x...) sub-grid that are not fitted yet
+      for (std::size_t i = 0; i < n_sub_points; i++) {
+        Lattice point = cell, start = cell;
+        auto digits = i;
+        for (std::size_t a = 0; a < n_axes; a++, digits /= 3) {
+          auto k = static_cast<long>(digits % 3);
+          point[a] += k * half;
+          start[a] += (k == 2) ? size : 0;
+        }
+        if (!state->m_points.count(point) && !wave.count(point)) {
+          wave[point] = start;
+        }
+      }
+      for (std::size_t i = 0; i < n_sub_cells; i++) {
+        Lattice sub_cell = cell;
+        for (std::size_t a = 0; a < n_axes; a++) {
+          sub_cell[a] += ((i >> a) & 1) * half;
+        }
+        split_cells.push_back(sub_cell);
+      }
+    }
+
+    if (wave.empty()) {
+      break;
+    }
+    spdlog::debug("LikelihoodScan: Refinement {} adds {} points.", r + 1,
+                  wave.size());
+    this->fit_wave(wave, state, pool, workspaces);
+    cells = split_cells;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void LikelihoodScan<SetupClass, Policy>::fit_wave(
+    const StartMap &wave, ScanState *state, Parallel::WorkStealingPool *pool,
+    Workspaces *workspaces) const {
+  /** Fit all points of the wave in parallel, each starting from the minimum
+      of its start point (the best fit for an empty start point).
+      The start points must already be fitted, the state only changes after
+      all fits of the wave finished.
+   **/
+  std::vector<std::pair<Lattice, ScanPoint>> fitted(wave.size());
+  std::vector<char> is_fitted(wave.size(), 0);
+
+  Parallel::Latch latch(wave.size());
+  std::size_t i = 0;
+  for (const auto &point_start : wave) {
+    const auto *point = &point_start.first;
+    const auto *start = &(state->m_best_fit);
+    auto start_it = state->m_points.find(point_start.second);
+    if (start_it != state->m_points.end()) {
+      start = &(start_it->second.m_result);
+    }
+
+    pool->submit([this, i, point, start, state, workspaces, &fitted,
+                  &is_fitted, &latch] {
+      std::exception_ptr error{};
+      try {
+        if (!this->is_cancelled()) {
+          auto worker = Parallel::WorkStealingPool::current_worker_index();
+          auto *workspace = this->get_workspace(
+              state->m_energy,
+              &workspaces->at(static_cast<std::size_t>(worker)));
+          fitted[i] = {*point,
+                       this->fit_point(*state, *point, *start, workspace)};
+          is_fitted[i] = 1;
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
+      latch.count_down(error);
+    });
+    i++;
+  }
+  latch.wait();
+
+  for (std::size_t f = 0; f < fitted.size(); f++) {
+    if (is_fitted[f]) {
+      state->m_points[fitted[f].first] = std::move(fitted[f].second);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+ScanPoint LikelihoodScan<SetupClass, Policy>::fit_point(
+    const ScanState &state, const Lattice &point,
+    const PrEW::Fit::FitResult &start, ToyWorkspace *workspace) const {
+  /** Fit the Asimov dataset with the scanned parameters fixed at the point,
+      starting all other parameters from the given result.
+   **/
+  auto *container = workspace->prepare_asimov();
+  auto &pars = container->m_fit_pars;
+  for (std::size_t p = 0; p < pars.size(); p++) {
+    if (p < start.m_pars_fin.size()) {
+      pars[p].m_val_mod = start.m_pars_fin[p];
+    }
+    if ((p < start.m_uncs_fin.size()) && (start.m_uncs_fin[p] > 0)) {
+      pars[p].m_unc_mod = start.m_uncs_fin[p];
+    }
+  }
+
+  // Fix the scanned parameters, the workspace keeps the originals
+  ScanPoint scan_point{};
+  scan_point.m_scan_vals = this->scan_vals(state, point);
+  PrEW::Fit::ParVec originals{};
+  for (std::size_t a = 0; a < state.m_par_indices.size(); a++) {
+    auto &par = pars[state.m_par_indices[a]];
+    originals.push_back(par);
+    par.m_val_mod = scan_point.m_scan_vals[a];
+    par.fix();
+  }
+
+  scan_point.m_result = this->minimize_chain(container, workspace);
+  scan_point.m_delta_fcn =
+      scan_point.m_result.m_chisq_fin - state.m_best_fit.m_chisq_fin;
+
+  for (std::size_t a = 0; a < state.m_par_indices.size(); a++) {
+    pars[state.m_par_indices[a]] = originals[a];
+  }
+  return scan_point;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+std::vector<double>
+LikelihoodScan<SetupClass, Policy>::scan_vals(const ScanState &state,
+                                              const Lattice &point) const {
+  /** Parameter values of a point on the lattice.
+   **/
+  std::vector<double> vals{};
+  for (std::size_t a = 0; a < state.m_axes.size(); a++) {
+    const auto &axis = state.m_axes[a];
+    double lattice_width = (axis.m_max - axis.m_min) /
+                           static_cast<double>((axis.m_n_points - 1) *
+                                               state.m_step);
+    vals.push_back(axis.m_min + static_cast<double>(point[a]) * lattice_width);
+  }
+  return vals;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+bool LikelihoodScan<SetupClass, Policy>::crosses_level(
+    const ScanState &state, const Lattice &corner, long size,
+    const std::vector<double> &levels) const {
+  /** Check whether the FCN values at the corners of the cell lie on both
+      sides of any of the levels.
+      Cells with a corner that wasn't fitted are never split.
+   **/
+  auto n_corners = std::size_t{1} << corner.size();
+  double min_fcn = 0, max_fcn = 0;
+  for (std::size_t c = 0; c < n_corners; c++) {
+    Lattice point = corner;
+    for (std::size_t a = 0; a < corner.size(); a++) {
+      point[a] += ((c >> a) & 1) * size;
+    }
+    auto point_it = state.m_points.find(point);
+    if (point_it == state.m_points.end()) {
+      return false;
+    }
+    double fcn = point_it->second.m_delta_fcn;
+    min_fcn = (c == 0) ? fcn : std::min(min_fcn, fcn);
+    max_fcn = (c == 0) ? fcn : std::max(max_fcn, fcn);
+  }
+  for (const auto &level : levels) {
+    if ((min_fcn < level) && (level <= max_fcn)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+ScanResult
+LikelihoodScan<SetupClass, Policy>::collect(const ScanState &state) const {
+  ScanResult result{};
+  for (const auto &axis : state.m_axes) {
+    result.m_par_names.push_back(axis.m_par_name);
+  }
+  result.m_best_fit = state.m_best_fit;
+  for (const auto &point : state.m_points) {
+    result.m_points.push_back(point.second);
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+} // Namespace Runners
+} // Namespace PrEWUtils
+
+#endif
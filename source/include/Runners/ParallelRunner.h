@@ -2,7 +2,24 @@
 #define LIB_PARALLELRUNNER_H 1
 
 #include <DataHelp/BinSelector.h>
+#include <Names/MinimizerInfo.h>
+#include <Output/AsyncSink.h>
+#include <Output/CheckpointSink.h>
+#include <Output/ResultSink.h>
+#include <Parallel/CancelToken.h>
+#include <Parallel/FileWorkQueue.h>
+#include <Parallel/Latch.h>
 #include <Parallel/ThreadPool.h>
+#include <Parallel/WorkStealingPool.h>
+#include <Random/ToyFlct.h>
+#include <Runners/ResultFidelity.h>
+#include <Runners/RunnerPolicies.h>
+#include <Runners/StoppingPolicy.h>
+#include <Runners/ToyBudget.h>
+#include <Runners/ToyPlan.h>
+#include <Runners/ToyTiming.h>
+#include <Runners/ToyTrace.h>
+#include <Runners/ToyWorkspace.h>
 #include <Setups/FitModifier.h>
 
 // Includes from PrEW
@@ -12,27 +29,71 @@
 #include "Fit/MinuitFactory.h"
 #include "ToyMeas/ToyGen.h"
 
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace PrEWUtils {
 namespace Runners {
   
-  template <class SetupClass>
+  template <class SetupClass, class Policy = Policies::DefaultPolicy>
   class ParallelRunner {
     /** Class to run a given toy setup in multiple threads in parallel.
+        The policy fixes at compile time which PrEW minimizer is used, how bins
+        are selected and what is extracted from the minimizer (see
+        Runners/RunnerPolicies.h), the defaults choose at run time.
     **/
     
     std::vector<int> m_energies;
     std::map<int, PrEW::Fit::ParVec> m_pars; // Parameters used at each energy
     PrEW::Connect::DataConnector m_data_connector;
     PrEW::ToyMeas::ToyGen m_toy_gen;
+    std::map<int, PrEW::Data::PredDistrVec> m_expected_distrs; // Toy input
+    std::map<int, ToyPlan> m_toy_plans; // Compiled toy setup per energy
+    Names::MinInfoVec m_minimizer_infos;
     std::vector<PrEW::Fit::MinuitFactory> m_minuit_factories;
-    std::string m_prew_minimizer;
+    typename Policy::Minimizer m_minimizer;
+    std::string m_minimizer_str; // Full minimizer description
     
     // Extra options
-    bool m_use_selector {false};
-    DataHelp::BinSelector m_bin_selector {};
+    typename Policy::Selection m_selection {};
+    int m_toys_per_chunk {0}; // 0 -> Determined from number of workers
+    int m_toys_per_round {0}; // 0 -> Determined from number of workers
+    std::uint64_t m_seed {}; // Campaign seed of the toy random streams
+    bool m_seed_is_set {false}; // Seed given by the user, not random
+    bool m_asimov_warm_start {false};
+    std::string m_checkpoint_dir {}; // Empty -> No checkpointing
+    std::size_t m_toys_per_checkpoint {100};
+    int m_shard_index {0};
+    int m_n_shards {1}; // 1 -> Runner does all toys itself
+    ToyBudget m_toy_budget {};
+    const Parallel::CancelToken * m_cancel_token {nullptr};
+    ToyTiming::TimingReport * m_timing_report {nullptr};
+    ToyTrace::Tracer * m_tracer {nullptr};
+    ResultFidelity m_result_fidelity {};
+    std::map<int, std::vector<std::size_t>> m_kept_pars {}; // Per energy
+    bool m_pin_workers {false};
+    bool m_numa_local_data {false};
+    
+    struct NodeData {
+      /** Read-only copy of the toy input, owned by one NUMA node.
+      **/
+      PrEW::Connect::DataConnector m_data_connector;
+      std::map<int, PrEW::Data::PredDistrVec> m_expected_distrs;
+      std::map<int, PrEW::Fit::ParVec> m_pars;
+      std::map<int, ToyPlan> m_toy_plans;
+    };
+    struct NodeCache {
+      std::mutex m_mutex {};
+      std::map<int, std::unique_ptr<NodeData>> m_nodes {};
+    };
+    // Shared by all runs until the setup changes
+    std::shared_ptr<NodeCache> m_node_cache {std::make_shared<NodeCache>()};
     
     public:
       // Constructors
@@ -43,10 +104,36 @@ namespace Runners {
       );
       
       // Set extra options
+      template <class Selection = typename Policy::Selection>
       void set_bin_selector(DataHelp::BinSelector bin_selector);
       void modify_fit(const Setups::FitModifier &modifier);
+      void set_toys_per_chunk(int toys_per_chunk);
+      void set_toys_per_round(int toys_per_round);
+      void set_seed(std::uint64_t seed);
+      void set_asimov_warm_start(bool use_warm_start = true);
+      void set_checkpointing(
+        const std::string & directory,
+        std::size_t toys_per_segment = 100
+      );
+      void set_shard(int shard_index, int n_shards);
+      void set_toy_budget(const ToyBudget & budget);
+      void set_cancel_token(const Parallel::CancelToken * token);
+      void set_timing_report(ToyTiming::TimingReport * report);
+      void set_tracer(ToyTrace::Tracer * tracer);
+      void set_result_fidelity(const ResultFidelity & fidelity);
+      void set_worker_pinning(
+        bool pin_workers = true,
+        bool numa_local_data = true
+      );
       
       // Running toy fits
+      PrEW::Fit::ResultVec run_toy_fits(
+        int energy,
+        int n_toys, 
+        Parallel::WorkStealingPool * pool 
+      ) const;
+      
+      [[deprecated("Use a Parallel::WorkStealingPool or a number of threads")]]
       PrEW::Fit::ResultVec run_toy_fits(
         int energy,
         int n_toys, 
@@ -64,21 +151,166 @@ namespace Runners {
         int n_threads
       ) const;
       
+      // Running toy fits with results streamed into a sink
+      void run_toy_fits(
+        int energy,
+        int n_toys,
+        Output::ResultSink * sink,
+        int n_threads
+      ) const;
+      
+      void run_toy_fits(
+        int n_toys,
+        Output::ResultSink * sink,
+        int n_threads
+      ) const;
+      
+      // Running toy fits until the stopping policy is satisfied
+      PrEW::Fit::ResultVec run_toy_fits(
+        int energy,
+        StoppingPolicy * stopping,
+        int n_threads
+      ) const;
+      
+      std::map<int,PrEW::Fit::ResultVec> run_toy_fits(
+        StoppingPolicy * stopping,
+        int n_threads
+      ) const;
+      
+      void run_toy_fits(
+        StoppingPolicy * stopping,
+        Output::ResultSink * sink,
+        int n_threads
+      ) const;
+      
+      // Running toy fits pulled from a queue shared with other processes
+      void run_toy_fits(
+        Parallel::FileWorkQueue * queue,
+        int n_threads
+      ) const;
+      
+      // Reproduce a single toy of the campaign
+      PrEW::Fit::FitResult run_single_toy(int energy, int toy_index) const;
+      
       // Get info about current setup
       const PrEW::Connect::DataConnector & get_data_connector() const;
+      const PrEW::Fit::ParVec & get_pars(int energy) const;
+      PrEW::Fit::ParVec get_result_pars(int energy) const;
+      std::uint64_t get_seed() const;
+      std::uint64_t get_fingerprint() const;
+      
+      using ToyChunk = std::pair<int,int>; // Range [first, last) of toys
+      ToyChunk get_shard_toys(int n_toys) const;
 
     protected:
       // Internal functions
       void set_minimizers( const std::string & minimizers_str );
+      void compile_toy_plans();
+      void warm_start_from_asimov(int energy);
+      
+      bool has_energy(int energy) const;
+      bool is_cancelled() const;
+      void check_stopping(const StoppingPolicy * stopping) const;
+      std::unique_ptr<Parallel::WorkStealingPool> make_pool(
+        int n_threads
+      ) const;
+      const NodeData & get_node_data(int node) const;
+      
+      using ResultHandler = std::function<
+        void(const Output::ToyInfo &, PrEW::Fit::FitResult &&)
+      >;
+      void run_on_pool(
+        const std::vector<int> & energies,
+        int n_toys,
+        const ResultHandler & handler,
+        Parallel::WorkStealingPool * pool
+      ) const;
+      std::map<int,PrEW::Fit::ResultVec> run_collect(
+        const std::vector<int> & energies,
+        int n_toys,
+        Parallel::WorkStealingPool * pool
+      ) const;
+      void run_until_stopped(
+        const std::vector<int> & energies,
+        StoppingPolicy * stopping,
+        const ResultHandler & handler,
+        Parallel::WorkStealingPool * pool
+      ) const;
+      
+      void run_from_queue(
+        const std::vector<int> & energies,
+        Parallel::FileWorkQueue * queue,
+        Parallel::WorkStealingPool * pool
+      ) const;
+      
+      using PoolRun = std::function<
+        void(const ResultHandler &, Parallel::WorkStealingPool *)
+      >;
+      void run_into_sink(
+        const PoolRun & run,
+        Output::ResultSink * sink,
+        int n_threads
+      ) const;
+      std::map<int,PrEW::Fit::ResultVec> run_collect_stopped(
+        const std::vector<int> & energies,
+        StoppingPolicy * stopping,
+        int n_threads
+      ) const;
       
-      PrEW::Fit::FitResult single_fit_task(int energy) const;
+      // Reusable toy containers of a single worker, per energy
+      using WorkerWorkspaces = std::map<int, std::unique_ptr<ToyWorkspace>>;
+      ToyWorkspace * get_workspace(
+        int energy,
+        WorkerWorkspaces * workspaces
+      ) const;
+      void report_timing(
+        const std::vector<WorkerWorkspaces> & workspaces,
+        ToyTiming::Clock::time_point start
+      ) const;
+      
+      using ChunkMap = std::map<int, std::vector<ToyChunk>>; // Per energy
+      std::vector<ToyChunk> get_toy_chunks(
+        int n_toys,
+        std::size_t n_workers
+      ) const;
+      std::vector<ToyChunk> get_index_chunks(
+        const std::vector<int> & toy_indices,
+        std::size_t n_workers
+      ) const;
+      void run_chunks(
+        const ChunkMap & chunks_map,
+        const ResultHandler & handler,
+        Parallel::WorkStealingPool * pool
+      ) const;
+      void submit_toy_chunk(
+        int energy,
+        ToyChunk chunk,
+        const ResultHandler * handler,
+        std::vector<WorkerWorkspaces> * workspaces,
+        Parallel::WorkStealingPool * pool,
+        Parallel::Latch * latch,
+        const Parallel::CancelToken * stop = nullptr
+      ) const;
+      
+      PrEW::Fit::FitResult single_fit_task(
+        int energy,
+        int toy_index,
+        ToyWorkspace * workspace
+      ) const;
+      
+      PrEW::Fit::FitResult minimize_chain(
+        PrEW::Fit::FitContainer * container_ptr,
+        ToyWorkspace * workspace
+      ) const;
       
       PrEW::Fit::FitResult single_minimization(
         PrEW::Fit::FitContainer * container_ptr, 
         const PrEW::Fit::MinuitFactory & minuit_factory
       ) const;
-      template<class MinimizerClass> PrEW::Fit::FitResult single_minimization(
-        MinimizerClass * Minimizer
+      
+      PrEW::Fit::FitResult budgeted_minimization(
+        PrEW::Fit::FitContainer * container_ptr,
+        ToyWorkspace * workspace
       ) const;
 
   };
@@ -2,33 +2,47 @@
 #define LIB_PARALLELRUNNER_TPP 1
 
 #include <Names/MinimizerNaming.h>
+#include <Output/Fingerprint.h>
+#include <Parallel/CpuTopology.h>
 #include <Runners/ParallelRunner.h>
 
 // Includes from PrEW
 #include "CppUtils/Str.h"
-#include "Fit/ChiSqMinimizer.h"
-#include "Fit/PoissonNLLMinimizer.h"
-#include "ToyMeas/ParFlct.h"
 
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <typeinfo>
+
 namespace PrEWUtils {
 namespace Runners {
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
-ParallelRunner<SetupClass>::ParallelRunner(const SetupClass &setup,
+template <class SetupClass, class Policy>
+ParallelRunner<SetupClass, Policy>::ParallelRunner(const SetupClass &setup,
                                            const std::string &minuit_minimizers,
                                            const std::string &prew_minimizer)
     : m_energies(setup.get_energies()),
       m_data_connector(setup.get_data_connector()),
       m_toy_gen(PrEW::ToyMeas::ToyGen(m_data_connector, setup.get_pars())),
-      m_prew_minimizer(prew_minimizer) {
+      m_minimizer(prew_minimizer),
+      m_minimizer_str(minuit_minimizers + "|" + prew_minimizer) {
   /** Constructor extracts all relevant information from the setup.
       Minuit/PrEW minimizer string describes which Minuit2/PrEW minimizers to
       use.
-      Allowed PrEW minimizers are:
+      Allowed PrEW minimizers are (if the minimizer policy was not fixed at
+      compile time, otherwise it must be the compiled one):
         ChiSquared
         PoissonNLL
       Allowed Minuit2 minimizers are:
@@ -40,112 +54,354 @@ ParallelRunner<SetupClass>::ParallelRunner(const SetupClass &setup,
         MigradBFGS
       Multiple Minuit2 minimizers can be given separated by a "->".
   **/
-  // Extract the parameters which should be fitted for a given energy
+  // Extract the parameters which should be fitted for a given energy and the
+  // expected distributions from which the toys are drawn
   for (const auto &energy : m_energies) {
     m_pars[energy] = setup.get_pars(energy);
+    m_expected_distrs[energy] = m_toy_gen.get_expected_distrs(energy);
   }
+  this->compile_toy_plans();
+
+  // Random campaign seed unless the user sets one
+  std::random_device random_device{};
+  m_seed = (static_cast<std::uint64_t>(random_device()) << 32) |
+           random_device();
+  spdlog::debug("ParallelRunner: Drew random campaign seed {}.", m_seed);
   // Set up Minuit2 minimizers
   this->set_minimizers(minuit_minimizers);
 }
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
-void ParallelRunner<SetupClass>::set_bin_selector(
+template <class SetupClass, class Policy>
+template <class Selection>
+void ParallelRunner<SetupClass, Policy>::set_bin_selector(
     DataHelp::BinSelector bin_selector) {
   /** Set a bin selector that excludes bins from the minimization process.
+      Only compiles if the selection policy allows a selector (a member
+      template, so explicit instantiations of the runner don't need it).
    **/
-  m_bin_selector = bin_selector;
-  m_use_selector = true;
+  static_assert(Selection::allows_selector,
+                "ParallelRunner: Policy was compiled without bin selection!");
+  m_selection.set(bin_selector);
+  this->compile_toy_plans();
 }
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
-void ParallelRunner<SetupClass>::modify_fit(
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::modify_fit(
     const Setups::FitModifier &modifier) {
   /** Add a modifier that changes the fit to the toy measurements.
       Notice that the toy measurements themselves will not be affected.
    **/
   modifier.modify_setup(&m_data_connector, &(m_pars[modifier.get_energy()]));
+  this->compile_toy_plans();
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_toys_per_chunk(
+    int toys_per_chunk) {
+  /** Set how many toys are grouped into a single task on the thread pool.
+      A value <= 0 lets the runner choose the chunk size from the number of
+      workers.
+   **/
+  m_toys_per_chunk = toys_per_chunk;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_toys_per_round(
+    int toys_per_round) {
+  /** Set how many toys per energy are submitted at once when running with a
+      stopping policy.
+      A value <= 0 lets the runner choose the round size from the number of
+      workers.
+   **/
+  m_toys_per_round = toys_per_round;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_seed(std::uint64_t seed) {
+  /** Set the campaign seed.
+      Toy i at energy E is fully determined by (seed, E, i), independent of
+      the number of threads or which toys are run together.
+   **/
+  m_seed = seed;
+  m_seed_is_set = true;
+  spdlog::info("ParallelRunner: Using campaign seed {}.", m_seed);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_asimov_warm_start(
+    bool use_warm_start) {
+  /** Let all toy fits start from the minimum of a fit to the Asimov
+      (unfluctuated) dataset, using its fitted uncertainties as initial step
+      sizes.
+      The Asimov fit is done once per energy right away (and redone if the fit
+      setup changes later).
+   **/
+  m_asimov_warm_start = use_warm_start;
+  this->compile_toy_plans();
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_checkpointing(
+    const std::string &directory, std::size_t toys_per_segment) {
+  /** Periodically save finished toys of fixed-size runs into the given
+      directory.
+      A later run with the same setup (see get_fingerprint) and seed loads the
+      toys found there and only fits the missing toy indices.
+      The seed must be set explicitly (set_seed), a run with a random seed
+      could never be resumed.
+      An empty directory name switches checkpointing off.
+   **/
+  m_checkpoint_dir = directory;
+  m_toys_per_checkpoint = toys_per_segment;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_shard(int shard_index,
+                                                   int n_shards) {
+  /** Let this runner do only its share of a campaign that is split over
+      n_shards independent jobs (e.g. on a batch cluster).
+      Fixed-size runs only fit the toy indices in get_shard_toys and return
+      those results in index order, runs with a stopping policy take every
+      n_shards-th round of toys.
+      With the same seed each toy gets the same random numbers as in an
+      unsharded run, so the shard outputs can be combined with
+      Output::ShardMerge (or the MergeShards tool) into the full campaign.
+   **/
+  if ((n_shards < 1) || (shard_index < 0) || (shard_index >= n_shards)) {
+    throw std::invalid_argument("ParallelRunner: Invalid shard " +
+                                std::to_string(shard_index) + " of " +
+                                std::to_string(n_shards));
+  }
+  m_shard_index = shard_index;
+  m_n_shards = n_shards;
+  spdlog::info("ParallelRunner: Running shard {} of {}.", m_shard_index,
+               m_n_shards);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_toy_budget(
+    const ToyBudget &budget) {
+  /** Limit the FCN calls and/or time spent on a single toy fit (see
+      Runners/ToyBudget.h), so that pathological toys can't hold up a
+      campaign.
+      Toys that exceed the budget are aborted and kept with status
+      ToyStatus::TimedOut.
+   **/
+  m_toy_budget = budget;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_cancel_token(
+    const Parallel::CancelToken *token) {
+  /** Let the runs of this runner watch the given token (nullptr for none).
+      Once it is cancelled no further toy is started, the toys that are
+      already running are finished and run_toy_fits returns the finished
+      results (in toy index order, without the toys that never ran).
+      Queued runs hand their unfinished batches back to the queue.
+   **/
+  m_cancel_token = token;
 }
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_timing_report(
+    ToyTiming::TimingReport *report) {
+  /** Fill the given report (nullptr for none) with the per-stage timing
+      breakdown at the end of every run.
+      Only has an effect if compiled with PREWUTILS_TIMING (see
+      Runners/ToyTiming.h).
+   **/
+  if (report && !ToyTiming::enabled) {
+    spdlog::warn("ParallelRunner: Timing report requested but timing was "
+                 "compiled out (PREWUTILS_TIMING not defined).");
+  }
+  m_timing_report = report;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_tracer(
+    ToyTrace::Tracer *tracer) {
+  /** Record the events of every toy (start, stages, minimizers, end) in the
+      given tracer (nullptr for none), which also logs the progress of the
+      runs.
+      The runner itself logs nothing per toy.
+   **/
+  m_tracer = tracer;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_result_fidelity(
+    const ResultFidelity &fidelity) {
+  /** Choose what is kept of the toy fit results (see
+      Runners/ResultFidelity.h), e.g. only values and errors of the TGCs.
+      The parameters of the trimmed results are given by get_result_pars.
+      Asimov warm starts and other internal fits are not trimmed.
+      Stopping policies that need uncertainties (e.g. a PrecisionStop on
+      pulls) are refused when only values are kept.
+   **/
+  m_result_fidelity = fidelity;
+  for (const auto &energy : m_energies) {
+    m_kept_pars[energy] = m_result_fidelity.kept_pars(m_pars.at(energy));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_worker_pinning(
+    bool pin_workers, bool numa_local_data) {
+  /** Pin the workers of the pools this runner creates to CPUs, spread evenly
+      over the NUMA nodes (see Parallel::CpuTopology).
+      With NUMA-local data the workers of each node build their containers
+      from a read-only copy of the setup data and toy plans that was created
+      (and thereby first touched) by a worker of that node, instead of
+      reading it across the interconnect.
+      Pools handed in by the user are not pinned.
+   **/
+  m_pin_workers = pin_workers;
+  m_numa_local_data = numa_local_data;
+  if (m_pin_workers || m_numa_local_data) {
+    spdlog::info("ParallelRunner: {} CPUs available on {} NUMA nodes.",
+                 Parallel::CpuTopology::available_cpus().size(),
+                 Parallel::CpuTopology::n_nodes());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
 PrEW::Fit::ResultVec
-ParallelRunner<SetupClass>::run_toy_fits(int energy, int n_toys,
-                                         linx::ThreadPool *pool) const {
+ParallelRunner<SetupClass, Policy>::run_toy_fits(
+    int energy, int n_toys, Parallel::WorkStealingPool *pool) const {
   /** Run a given number of toy measurements at the given energy on a given
       thread pool.
       Returns the corresponding fit results.
   **/
-
-  // Check that energy is available
-  if (std::find(m_energies.begin(), m_energies.end(), energy) ==
-      m_energies.end()) {
-    spdlog::error("ParallelRunner: Energy {} not available!", energy);
+  if (!this->has_energy(energy)) {
     return {};
   }
+  return this->run_collect({energy}, n_toys, pool).at(energy);
+}
 
-  PrEW::Fit::ResultVec results(n_toys);
-  std::vector<std::future<PrEW::Fit::FitResult>> result_futures(n_toys);
+//------------------------------------------------------------------------------
 
-  spdlog::debug("ParallelRunner: Start registering jobs for each toy @ E={}.",
-                energy);
-  for (size_t i = 0; i < results.size(); i++) {
-    // Create task with cpu-heavy work that can be executed on separate core
-    spdlog::debug("ParallelRunner: Creating task {} @ E={}.", i, energy);
-    auto task = [this, &energy]() { return this->single_fit_task(energy); };
-    // Queue the task -> ThreadPool will start it when resource available
-    spdlog::debug("ParallelRunner: Queuing task {} @ E={}.", i, energy);
-    result_futures[i] = pool->enqueue(task);
+template <class SetupClass, class Policy>
+PrEW::Fit::ResultVec
+ParallelRunner<SetupClass, Policy>::run_toy_fits(
+    int energy, int n_toys, linx::ThreadPool *pool) const {
+  /** Run a given number of toy measurements at the given energy on a given
+      linx::ThreadPool.
+      Deprecated, only kept for callers that still own such a pool: every toy
+      goes through the single queue of that pool and there is no
+      checkpointing. Each thread of the pool reuses its own workspace,
+      sharding and cancellation work as in the other overloads.
+      Returns the results of the finished toys, ordered by toy index.
+  **/
+  if (!this->has_energy(energy)) {
+    return {};
   }
+  auto shard_toys = this->get_shard_toys(n_toys);
 
-  spdlog::debug("ParallelRunner: All threads registered @ E={}, waiting for "
-                "them to return results.",
-                energy);
-  for (size_t i = 0; i < results.size(); i++) {
-    results[i] = result_futures[i].get();
+  // Workspaces by pool thread, map nodes stay in place while others are added
+  std::mutex workspaces_mutex{};
+  std::map<std::thread::id, WorkerWorkspaces> thread_workspaces{};
+  using ToyFuture = std::future<std::unique_ptr<PrEW::Fit::FitResult>>;
+  std::vector<ToyFuture> result_futures{};
+  for (int t = shard_toys.first; t < shard_toys.second; t++) {
+    result_futures.push_back(pool->enqueue([this, energy, t, &workspaces_mutex,
+                                            &thread_workspaces] {
+      std::unique_ptr<PrEW::Fit::FitResult> result{};
+      if (this->is_cancelled()) {
+        return result;
+      }
+      WorkerWorkspaces *workspaces = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(workspaces_mutex);
+        workspaces = &thread_workspaces[std::this_thread::get_id()];
+      }
+      result = std::make_unique<PrEW::Fit::FitResult>(this->single_fit_task(
+          energy, t, this->get_workspace(energy, workspaces)));
+      return result;
+    }));
   }
 
+  // Wait for all toys before failing, the tasks reference this stack frame
+  PrEW::Fit::ResultVec results{};
+  std::exception_ptr error{};
+  for (auto &result_future : result_futures) {
+    try {
+      auto result = result_future.get();
+      if (result) {
+        results.push_back(std::move(*result));
+      }
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
   return results;
 }
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
+template <class SetupClass, class Policy>
 PrEW::Fit::ResultVec
-ParallelRunner<SetupClass>::run_toy_fits(int energy, int n_toys,
-                                         int n_threads) const {
+ParallelRunner<SetupClass, Policy>::run_toy_fits(int energy, int n_toys,
+                                                 int n_threads) const {
   /** Run a given number of toy measurements at the given energy on a given
       number of threads.
       Returns the corresponding fit results.
   **/
   spdlog::debug("ParallelRunner: Creating thread pool for E={}.", energy);
-  linx::ThreadPool pool(n_threads);
-  return this->run_toy_fits(energy, n_toys, &pool);
+  auto pool = this->make_pool(n_threads);
+  return this->run_toy_fits(energy, n_toys, pool.get());
 }
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
+template <class SetupClass, class Policy>
 std::map<int, PrEW::Fit::ResultVec>
-ParallelRunner<SetupClass>::run_toy_fits(int n_toys, int n_threads) const {
+ParallelRunner<SetupClass, Policy>::run_toy_fits(int n_toys,
+                                                 int n_threads) const {
   /** Run a given number of toy measurements for all available energies on a
       given number of threads.
+      The toys of all energies are in flight on the same pool at the same time,
+      so no energy has to drain before the next one starts.
       Returns the corresponding fit results for each energy.
   **/
-  // Output maps energy to vector of fit results
-  std::map<int, PrEW::Fit::ResultVec> results_map{};
-
   spdlog::debug(
       "ParallelRunner: Creating thread pool for all available energies.");
-  linx::ThreadPool pool(n_threads);
-
-  for (const auto &energy : m_energies) {
-    results_map[energy] = this->run_toy_fits(energy, n_toys, &pool);
-  }
+  auto pool = this->make_pool(n_threads);
+  auto results_map = this->run_collect(m_energies, n_toys, pool.get());
 
   spdlog::debug("ParallelRunner: Done with all energies!");
   return results_map;
@@ -153,20 +409,228 @@ ParallelRunner<SetupClass>::run_toy_fits(int n_toys, int n_threads) const {
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_toy_fits(
+    int energy, int n_toys, Output::ResultSink *sink, int n_threads) const {
+  /** Run a given number of toy measurements at the given energy on a given
+      number of threads.
+      Each result is handed to the sink as soon as its toy is finished, the
+      sink is called from a dedicated writer thread.
+  **/
+  if (!this->has_energy(energy)) {
+    return;
+  }
+  this->run_into_sink(
+      [this, energy, n_toys](const ResultHandler &handler,
+                             Parallel::WorkStealingPool *pool) {
+        this->run_on_pool({energy}, n_toys, handler, pool);
+      },
+      sink, n_threads);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_toy_fits(
+    int n_toys, Output::ResultSink *sink, int n_threads) const {
+  /** Run a given number of toy measurements for all available energies on a
+      given number of threads.
+      Each result is handed to the sink as soon as its toy is finished, the
+      sink is called from a dedicated writer thread.
+  **/
+  this->run_into_sink(
+      [this, n_toys](const ResultHandler &handler,
+                     Parallel::WorkStealingPool *pool) {
+        this->run_on_pool(m_energies, n_toys, handler, pool);
+      },
+      sink, n_threads);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+PrEW::Fit::ResultVec
+ParallelRunner<SetupClass, Policy>::run_toy_fits(int energy,
+                                                 StoppingPolicy *stopping,
+                                                 int n_threads) const {
+  /** Run toy measurements at the given energy on a given number of threads
+      until the stopping policy is satisfied.
+      Returns the results of all completed toys, ordered by toy index.
+  **/
+  if (!this->has_energy(energy)) {
+    return {};
+  }
+  return this->run_collect_stopped({energy}, stopping, n_threads).at(energy);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+std::map<int, PrEW::Fit::ResultVec>
+ParallelRunner<SetupClass, Policy>::run_toy_fits(StoppingPolicy *stopping,
+                                                 int n_threads) const {
+  /** Run toy measurements for all available energies on a given number of
+      threads until the stopping policy is satisfied.
+      Returns the results of all completed toys for each energy, ordered by
+      toy index.
+  **/
+  return this->run_collect_stopped(m_energies, stopping, n_threads);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_toy_fits(
+    StoppingPolicy *stopping, Output::ResultSink *sink, int n_threads) const {
+  /** Run toy measurements for all available energies on a given number of
+      threads until the stopping policy is satisfied.
+      Each result is handed to the sink as soon as its toy is finished, the
+      sink is called from a dedicated writer thread.
+  **/
+  this->check_stopping(stopping);
+  this->run_into_sink(
+      [this, stopping](const ResultHandler &handler,
+                       Parallel::WorkStealingPool *pool) {
+        this->run_until_stopped(m_energies, stopping, handler, pool);
+      },
+      sink, n_threads);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_toy_fits(
+    Parallel::FileWorkQueue *queue, int n_threads) const {
+  /** Run toy batches for all available energies on a given number of threads,
+      pulling them from a queue directory shared with other processes until
+      the whole campaign is done.
+      The results of each batch end up in the queue's result files, which can
+      be combined with Output::ShardMerge (or the MergeShards tool).
+      The queue must have been opened with the fingerprint of this runner.
+   **/
+  if (queue->get_fingerprint() != this->get_fingerprint()) {
+    throw std::invalid_argument(
+        "ParallelRunner: Queue belongs to a different setup or seed.");
+  }
+  auto pool = this->make_pool(n_threads);
+  this->run_from_queue(m_energies, queue, pool.get());
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+PrEW::Fit::FitResult
+ParallelRunner<SetupClass, Policy>::run_single_toy(int energy,
+                                                   int toy_index) const {
+  /** Rerun a single toy of the campaign on the calling thread.
+      Gives the same result as the toy with this index in any run_toy_fits
+      call with the same seed.
+   **/
+  if (!this->has_energy(energy)) {
+    throw std::invalid_argument("ParallelRunner: Energy not available " +
+                                std::to_string(energy));
+  }
+  WorkerWorkspaces workspaces{};
+  return this->single_fit_task(energy, toy_index,
+                               this->get_workspace(energy, &workspaces));
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
 const PrEW::Connect::DataConnector &
-ParallelRunner<SetupClass>::get_data_connector() const {
+ParallelRunner<SetupClass, Policy>::get_data_connector() const {
   return m_data_connector;
 }
 
+template <class SetupClass, class Policy>
+const PrEW::Fit::ParVec &
+ParallelRunner<SetupClass, Policy>::get_pars(int energy) const {
+  return m_pars.at(energy);
+}
+
+template <class SetupClass, class Policy>
+PrEW::Fit::ParVec
+ParallelRunner<SetupClass, Policy>::get_result_pars(int energy) const {
+  /** Parameters of the toy results at the given energy, in their order.
+   **/
+  PrEW::Fit::ParVec result_pars{};
+  for (const auto &index : m_kept_pars.at(energy)) {
+    result_pars.push_back(m_pars.at(energy)[index]);
+  }
+  return result_pars;
+}
+
+template <class SetupClass, class Policy>
+std::uint64_t ParallelRunner<SetupClass, Policy>::get_seed() const {
+  return m_seed;
+}
+
+template <class SetupClass, class Policy>
+std::uint64_t ParallelRunner<SetupClass, Policy>::get_fingerprint() const {
+  /** Fingerprint of everything that determines the toy results: seed,
+      policies, minimizers, fit parameters and the compiled toy plans.
+      Changes of the fit model are caught through the bin predictions at the
+      toy starting point.
+   **/
+  Output::Fingerprint fingerprint{};
+  fingerprint.add(static_cast<std::int64_t>(m_seed));
+  fingerprint.add(std::string(typeid(Policy).name()));
+  fingerprint.add(m_minimizer_str);
+  fingerprint.add(static_cast<std::int64_t>(m_asimov_warm_start));
+  fingerprint.add(static_cast<std::int64_t>(m_toy_budget.m_max_fcn_calls));
+  fingerprint.add(m_toy_budget.m_max_time.count());
+  fingerprint.add(static_cast<std::int64_t>(m_result_fidelity.m_level));
+  for (const auto &category : m_result_fidelity.m_categories) {
+    fingerprint.add(category);
+  }
+
+  for (const auto &energy : m_energies) {
+    fingerprint.add(static_cast<std::int64_t>(energy));
+    for (const auto &par : m_pars.at(energy)) {
+      fingerprint.add(par.get_name());
+      fingerprint.add(par.m_val_mod);
+      fingerprint.add(par.m_unc_mod);
+      if (par.has_constr()) {
+        fingerprint.add(par.get_constrgauss().m_val);
+        fingerprint.add(par.get_constrgauss().m_unc);
+      }
+    }
+
+    const auto &plan = m_toy_plans.at(energy);
+    fingerprint.add(plan.get_expected_bins());
+    fingerprint.add(plan.get_kept_bins());
+
+    ToyWorkspace workspace(m_data_connector, m_expected_distrs.at(energy),
+                           m_pars.at(energy), &plan);
+    for (const auto &bin : workspace.prepare_asimov()->m_fit_bins) {
+      fingerprint.add(bin.get_val_prd());
+    }
+  }
+  return fingerprint.get();
+}
+
+template <class SetupClass, class Policy>
+typename ParallelRunner<SetupClass, Policy>::ToyChunk
+ParallelRunner<SetupClass, Policy>::get_shard_toys(int n_toys) const {
+  /** Contiguous range of toy indices [first, last) this runner does out of a
+      campaign of n_toys toys.
+      The shard sizes differ by at most one toy.
+   **/
+  auto first = static_cast<std::int64_t>(n_toys) * m_shard_index / m_n_shards;
+  auto last =
+      static_cast<std::int64_t>(n_toys) * (m_shard_index + 1) / m_n_shards;
+  return {static_cast<int>(first), static_cast<int>(last)};
+}
+
 //------------------------------------------------------------------------------
 // Internal functions
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
-void ParallelRunner<SetupClass>::set_minimizers(
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::set_minimizers(
     const std::string &minimizers_str) {
   /** Decipher minimizer_str to figure out which minimizers are to be used and
       add their factories in order to the vector of minimizers.
@@ -184,9 +648,10 @@ void ParallelRunner<SetupClass>::set_minimizers(
       Generic example:
         "MinimizerID1(MaxFcnCalls,MaxIters,Tolerance)->MinimizerID1(MaxFcnCalls,MaxIters,Tolerance)->..."
   **/
-  auto min_infos = Names::MinimizerNaming::read_mininimizer_str(minimizers_str);
+  m_minimizer_infos =
+      Names::MinimizerNaming::read_mininimizer_str(minimizers_str);
 
-  for (const auto &min_info : min_infos) {
+  for (const auto &min_info : m_minimizer_infos) {
     m_minuit_factories.push_back(
         PrEW::Fit::MinuitFactory(min_info.m_type, min_info.m_max_fcn_calls,
                                  min_info.m_max_iters, min_info.m_tolerance));
@@ -195,76 +660,915 @@ void ParallelRunner<SetupClass>::set_minimizers(
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
+template <class SetupClass, class Policy>
+std::vector<typename ParallelRunner<SetupClass, Policy>::ToyChunk>
+ParallelRunner<SetupClass, Policy>::get_toy_chunks(
+    int n_toys, std::size_t n_workers) const {
+  /** Split the toys into contiguous chunks.
+      Unless a chunk size was set explicitly each worker gets about four chunks
+      so that the load stays balanced towards the end.
+   **/
+  int toys_per_chunk = m_toys_per_chunk;
+  if (toys_per_chunk <= 0) {
+    int n_chunks_target = 4 * static_cast<int>(n_workers);
+    toys_per_chunk = (n_toys + n_chunks_target - 1) / n_chunks_target;
+  }
+  toys_per_chunk = std::max(toys_per_chunk, 1);
+
+  std::vector<ToyChunk> chunks{};
+  for (int first = 0; first < n_toys; first += toys_per_chunk) {
+    chunks.push_back({first, std::min(first + toys_per_chunk, n_toys)});
+  }
+  return chunks;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+std::vector<typename ParallelRunner<SetupClass, Policy>::ToyChunk>
+ParallelRunner<SetupClass, Policy>::get_index_chunks(
+    const std::vector<int> &toy_indices, std::size_t n_workers) const {
+  /** Split the given (ascending) toy indices into chunks of contiguous
+      indices, with the same chunk size as a run over that many toys.
+   **/
+  auto n_toys = static_cast<int>(toy_indices.size());
+  int toys_per_chunk = n_toys;
+  auto all_chunks = this->get_toy_chunks(n_toys, n_workers);
+  if (!all_chunks.empty()) {
+    toys_per_chunk = all_chunks.front().second - all_chunks.front().first;
+  }
+
+  std::vector<ToyChunk> chunks{};
+  for (const auto &index : toy_indices) {
+    if (chunks.empty() || (chunks.back().second != index) ||
+        (chunks.back().second - chunks.back().first >= toys_per_chunk)) {
+      chunks.push_back({index, index + 1});
+    } else {
+      chunks.back().second++;
+    }
+  }
+  return chunks;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::compile_toy_plans() {
+  /** (Re)compile the toy plans of all energies from the current fit setup.
+      Must be called whenever the connector, parameters or selection change.
+   **/
+  for (const auto &energy : m_energies) {
+    m_toy_plans[energy] =
+        ToyPlan(m_data_connector, m_expected_distrs.at(energy),
+                m_pars.at(energy), m_selection.get());
+    m_kept_pars[energy] = m_result_fidelity.kept_pars(m_pars.at(energy));
+    if (m_asimov_warm_start) {
+      this->warm_start_from_asimov(energy);
+    }
+  }
+  // Drop the node copies of the old setup
+  m_node_cache = std::make_shared<NodeCache>();
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::warm_start_from_asimov(int energy) {
+  /** Fit the Asimov dataset at the given energy with the full minimizer chain
+      and let the toys start from its minimum.
+   **/
+  spdlog::debug("ParallelRunner: Fitting Asimov dataset @ E={}.", energy);
+  auto &plan = m_toy_plans.at(energy);
+  ToyWorkspace workspace(m_data_connector, m_expected_distrs.at(energy),
+                         m_pars.at(energy), &plan);
+  auto *container = workspace.prepare_asimov();
+
+  // Full result needed independent of what the toys extract
+  PrEW::Fit::FitResult result{};
+  for (const auto &minuit_factory : m_minuit_factories) {
+    result = m_minimizer.template minimize<Policies::FullResult>(
+        container, minuit_factory);
+  }
+
+  plan.set_start(result.m_pars_fin, result.m_uncs_fin);
+  spdlog::info("ParallelRunner: Toys @ E={} start from Asimov minimum.",
+               energy);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+bool ParallelRunner<SetupClass, Policy>::has_energy(int energy) const {
+  /** Check that the energy is available, complain if it isn't.
+   **/
+  if (std::find(m_energies.begin(), m_energies.end(), energy) ==
+      m_energies.end()) {
+    spdlog::error("ParallelRunner: Energy {} not available!", energy);
+    return false;
+  }
+  return true;
+}
+
+template <class SetupClass, class Policy>
+bool ParallelRunner<SetupClass, Policy>::is_cancelled() const {
+  return m_cancel_token && m_cancel_token->is_cancelled();
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::check_stopping(
+    const StoppingPolicy *stopping) const {
+  /** Refuse stopping policies that read uncertainties the result fidelity
+      drops before the policy sees the results.
+   **/
+  if (stopping->needs_uncertainties() &&
+      !m_result_fidelity.keeps_uncertainties()) {
+    throw std::invalid_argument(
+        "ParallelRunner: Stopping policy needs uncertainties, but the result "
+        "fidelity only keeps values.");
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+std::unique_ptr<Parallel::WorkStealingPool>
+ParallelRunner<SetupClass, Policy>::make_pool(int n_threads) const {
+  /** Create a pool for a run, with pinned workers if requested.
+   **/
+  auto n_workers = static_cast<std::size_t>(std::max(n_threads, 1));
+  if (!m_pin_workers) {
+    return std::make_unique<Parallel::WorkStealingPool>(n_workers);
+  }
+  auto cpus = Parallel::CpuTopology::spread_cpus(n_workers);
+  return std::make_unique<Parallel::WorkStealingPool>(
+      n_workers, [cpus](int worker) {
+        auto cpu = cpus.at(static_cast<std::size_t>(worker));
+        if (!Parallel::CpuTopology::pin_current_thread(cpu)) {
+          spdlog::warn("ParallelRunner: Couldn't pin worker {} to CPU {}.",
+                       worker, cpu);
+        }
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+const typename ParallelRunner<SetupClass, Policy>::NodeData &
+ParallelRunner<SetupClass, Policy>::get_node_data(int node) const {
+  /** Copy of the toy input for the given NUMA node, created by the first
+      worker of that node that asks for it so that its memory is allocated on
+      that node.
+   **/
+  auto &cache = *m_node_cache;
+  std::lock_guard<std::mutex> lock(cache.m_mutex);
+  auto &node_data = cache.m_nodes[node];
+  if (!node_data) {
+    spdlog::debug("ParallelRunner: Copying setup data to NUMA node {}.", node);
+    node_data.reset(new NodeData{m_data_connector, m_expected_distrs, m_pars,
+                                 m_toy_plans});
+  }
+  return *node_data;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_on_pool(
+    const std::vector<int> &energies, int n_toys, const ResultHandler &handler,
+    Parallel::WorkStealingPool *pool) const {
+  /** Run the toys of all given energies on the pool and hand each result to
+      the handler, which must be safe to call from all workers.
+   **/
+  auto shard_toys = this->get_shard_toys(n_toys);
+  auto shard_chunks = this->get_toy_chunks(
+      shard_toys.second - shard_toys.first, pool->size());
+  for (auto &chunk : shard_chunks) {
+    chunk.first += shard_toys.first;
+    chunk.second += shard_toys.first;
+  }
+
+  ChunkMap chunks_map{};
+  for (const auto &energy : energies) {
+    chunks_map[energy] = shard_chunks;
+  }
+  this->run_chunks(chunks_map, handler, pool);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+std::map<int, PrEW::Fit::ResultVec>
+ParallelRunner<SetupClass, Policy>::run_collect(
+    const std::vector<int> &energies, int n_toys,
+    Parallel::WorkStealingPool *pool) const {
+  /** Run the toys of all given energies on the pool and collect the results
+      by energy and toy index.
+      With checkpointing, toys found in the checkpoint directory are taken
+      from there, only the missing ones are fitted and those are saved by a
+      writer thread while the workers continue.
+      When sharded, only the toys of this shard are run and collected.
+      If the run is cancelled only the finished toys are returned.
+   **/
+  auto shard_toys = this->get_shard_toys(n_toys);
+  auto n_shard_toys = shard_toys.second - shard_toys.first;
+
+  // Output maps energy to vector of fit results, preallocated before any task
+  // can write into it
+  std::map<int, PrEW::Fit::ResultVec> results_map{};
+  std::map<int, std::vector<char>> finished_map{}; // Only needed on cancel
+  ChunkMap chunks_map{};
+  for (const auto &energy : energies) {
+    results_map[energy] = PrEW::Fit::ResultVec(n_shard_toys);
+    finished_map[energy] = std::vector<char>(n_shard_toys, false);
+  }
+  auto store = [&results_map, &finished_map,
+                &shard_toys](const Output::ToyInfo &info,
+                             PrEW::Fit::FitResult &&result) {
+    auto index = static_cast<std::size_t>(info.m_toy_index - shard_toys.first);
+    results_map.at(info.m_energy)[index] = std::move(result);
+    finished_map.at(info.m_energy)[index] = true;
+  };
+  auto drop_unfinished = [this, &results_map, &finished_map] {
+    if (!this->is_cancelled()) {
+      return;
+    }
+    for (auto &energy_results : results_map) {
+      const auto &finished = finished_map.at(energy_results.first);
+      PrEW::Fit::ResultVec finished_results{};
+      for (std::size_t t = 0; t < finished.size(); t++) {
+        if (finished[t]) {
+          finished_results.push_back(std::move(energy_results.second[t]));
+        }
+      }
+      spdlog::warn("ParallelRunner: Cancelled, returning {} of {} toys @ "
+                   "E={}.",
+                   finished_results.size(), finished.size(),
+                   energy_results.first);
+      energy_results.second = std::move(finished_results);
+    }
+  };
+
+  if (m_checkpoint_dir.empty()) {
+    ResultHandler handler = store;
+    this->run_on_pool(energies, n_toys, handler, pool);
+    drop_unfinished();
+    return results_map;
+  }
+
+  if (!m_seed_is_set) {
+    throw std::invalid_argument(
+        "ParallelRunner: Checkpointing needs an explicit seed (set_seed), a "
+        "run with a random seed can't be resumed!");
+  }
+  auto fingerprint = this->get_fingerprint();
+  auto checkpoint =
+      Output::CheckpointSink::load(m_checkpoint_dir, fingerprint);
+  for (const auto &energy : energies) {
+    auto &done = checkpoint[energy];
+    std::vector<int> missing{};
+    for (int t = shard_toys.first; t < shard_toys.second; t++) {
+      auto done_it = done.find(t);
+      if (done_it == done.end()) {
+        missing.push_back(t);
+      } else {
+        store({energy, t}, std::move(done_it->second));
+      }
+    }
+    spdlog::info("ParallelRunner: Resuming with {} of {} toys @ E={} from "
+                 "checkpoint.",
+                 n_shard_toys - static_cast<int>(missing.size()), n_shard_toys,
+                 energy);
+    chunks_map[energy] = this->get_index_chunks(missing, pool->size());
+  }
+
+  Output::CheckpointSink checkpoint_sink(m_checkpoint_dir, fingerprint,
+                                         m_toys_per_checkpoint);
+  Output::AsyncSink async_sink(&checkpoint_sink);
+  ResultHandler handler = [&store, &async_sink](
+                              const Output::ToyInfo &info,
+                              PrEW::Fit::FitResult &&result) {
+    async_sink.consume(info, result);
+    store(info, std::move(result));
+  };
+  this->run_chunks(chunks_map, handler, pool);
+  async_sink.finish();
+  drop_unfinished();
+  return results_map;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_chunks(
+    const ChunkMap &chunks_map, const ResultHandler &handler,
+    Parallel::WorkStealingPool *pool) const {
+  /** Run the given toy chunks on the pool and hand each result to the
+      handler, which must be safe to call from all workers.
+      All chunks count down a single latch.
+   **/
+  auto start = ToyTiming::Clock::now();
+  std::size_t n_chunks = 0;
+  for (const auto &energy_chunks : chunks_map) {
+    n_chunks += energy_chunks.second.size();
+  }
+
+  // Every worker builds its own workspace per energy on first use and
+  // reuses it for all its further toys of this run
+  std::vector<WorkerWorkspaces> workspaces(pool->size());
+
+  Parallel::Latch latch(n_chunks);
+  for (const auto &energy_chunks : chunks_map) {
+    spdlog::debug("ParallelRunner: Submitting {} chunks @ E={}.",
+                  energy_chunks.second.size(), energy_chunks.first);
+    for (const auto &chunk : energy_chunks.second) {
+      this->submit_toy_chunk(energy_chunks.first, chunk, &handler, &workspaces,
+                             pool, &latch);
+    }
+  }
+
+  spdlog::debug("ParallelRunner: All toys submitted, waiting for them to "
+                "finish.");
+  latch.wait();
+  this->report_timing(workspaces, start);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_until_stopped(
+    const std::vector<int> &energies, StoppingPolicy *stopping,
+    const ResultHandler &handler, Parallel::WorkStealingPool *pool) const {
+  /** Run toys of all given energies in rounds of consecutive toy indices until
+      the stopping policy is satisfied.
+      Two rounds are kept in flight so that the workers never idle while the
+      slowest toys of the older round finish.
+      The policy is consulted regularly on all toys finished so far, once it
+      wants to stop no further toy is started and the toys that are already
+      running are completed and handed to the handler.
+      The same happens if the run is cancelled.
+      When sharded, the rounds are dealt out to the shards in turn.
+   **/
+  const auto check_interval = std::chrono::milliseconds(100);
+  auto start = ToyTiming::Clock::now();
+
+  int toys_per_round = m_toys_per_round;
+  if (toys_per_round <= 0) {
+    toys_per_round = 4 * static_cast<int>(pool->size());
+  }
+  auto round_chunks = this->get_toy_chunks(toys_per_round, pool->size());
+
+  // The policy only sees the results under the lock
+  std::mutex stopping_mutex{};
+  ResultHandler checked_handler =
+      [&stopping_mutex, stopping, &handler](const Output::ToyInfo &info,
+                                            PrEW::Fit::FitResult &&result) {
+        {
+          std::lock_guard<std::mutex> lock(stopping_mutex);
+          stopping->add_result(info, result);
+        }
+        handler(info, std::move(result));
+      };
+  auto should_stop = [&stopping_mutex, stopping] {
+    std::lock_guard<std::mutex> lock(stopping_mutex);
+    return stopping->should_stop();
+  };
+
+  std::vector<WorkerWorkspaces> workspaces(pool->size());
+  Parallel::CancelToken stop{};
+  std::deque<std::unique_ptr<Parallel::Latch>> rounds{};
+  int first_toy = m_shard_index * toys_per_round;
+  auto submit_round = [&] {
+    rounds.push_back(std::make_unique<Parallel::Latch>(round_chunks.size() *
+                                                       energies.size()));
+    for (const auto &energy : energies) {
+      for (const auto &chunk : round_chunks) {
+        this->submit_toy_chunk(
+            energy, {first_toy + chunk.first, first_toy + chunk.second},
+            &checked_handler, &workspaces, pool, rounds.back().get(), &stop);
+      }
+    }
+    first_toy += m_n_shards * toys_per_round;
+  };
+
+  stopping->start(energies);
+  submit_round();
+  submit_round();
+  try {
+    while (!stop.is_cancelled()) {
+      if (rounds.front()->wait_for(check_interval)) {
+        rounds.pop_front();
+        submit_round();
+      }
+      if (should_stop() || this->is_cancelled()) {
+        stop.cancel();
+      }
+    }
+  } catch (...) {
+    // Don't leave tasks behind that reference this stack frame
+    stop.cancel();
+    for (auto &round : rounds) {
+      try {
+        round->wait();
+      } catch (...) {
+      }
+    }
+    throw;
+  }
+
+  spdlog::debug("ParallelRunner: Stopping policy satisfied, finishing running "
+                "toys.");
+  for (auto &round : rounds) {
+    round->wait();
+  }
+  this->report_timing(workspaces, start);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_from_queue(
+    const std::vector<int> &energies, Parallel::FileWorkQueue *queue,
+    Parallel::WorkStealingPool *pool) const {
+  /** Claim batches from the queue and run the toys of all given energies in
+      them, keeping two batches in flight so that the workers never idle while
+      the slowest toys of the older batch finish.
+      While waiting, the claims are kept alive through the queue heartbeat.
+      Once nothing is left to claim the runner keeps polling until the
+      campaign is complete, so that batches abandoned by crashed processes are
+      picked up.
+      If the run is cancelled no further batch is claimed and batches that
+      could not be finished are released.
+   **/
+  auto start = ToyTiming::Clock::now();
+  auto poll_interval = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::min<std::chrono::duration<double>>(queue->get_claim_timeout() / 4.0,
+                                              std::chrono::seconds(10)));
+
+  using InfoResult = std::pair<Output::ToyInfo, PrEW::Fit::FitResult>;
+  struct QueuedBatch {
+    Parallel::FileWorkQueue::Batch m_batch{};
+    std::unique_ptr<Parallel::Latch> m_latch{};
+    Output::ResultIO::InfoResultVec m_results{};
+    std::mutex m_mutex{};
+    ResultHandler m_handler{};
+  };
+
+  std::vector<WorkerWorkspaces> workspaces(pool->size());
+  std::deque<std::unique_ptr<QueuedBatch>> in_flight{};
+  auto claim_batches = [&] {
+    Parallel::FileWorkQueue::Batch batch{};
+    while ((in_flight.size() < 2) && !this->is_cancelled() &&
+           queue->claim(&batch)) {
+      auto chunks = this->get_toy_chunks(
+          batch.m_last_toy - batch.m_first_toy, pool->size());
+      auto queued = std::make_unique<QueuedBatch>();
+      auto *queued_ptr = queued.get();
+      queued->m_batch = batch;
+      queued->m_latch =
+          std::make_unique<Parallel::Latch>(chunks.size() * energies.size());
+      queued->m_handler = [queued_ptr](const Output::ToyInfo &info,
+                                       PrEW::Fit::FitResult &&result) {
+        std::lock_guard<std::mutex> lock(queued_ptr->m_mutex);
+        queued_ptr->m_results.emplace_back(info, std::move(result));
+      };
+      in_flight.push_back(std::move(queued));
+
+      for (const auto &energy : energies) {
+        for (const auto &chunk : chunks) {
+          this->submit_toy_chunk(energy,
+                                 {batch.m_first_toy + chunk.first,
+                                  batch.m_first_toy + chunk.second},
+                                 &(queued_ptr->m_handler), &workspaces, pool,
+                                 queued_ptr->m_latch.get());
+        }
+      }
+    }
+  };
+
+  try {
+    claim_batches();
+    while (!in_flight.empty() ||
+           (!this->is_cancelled() && !queue->is_complete())) {
+      if (in_flight.empty()) {
+        std::this_thread::sleep_for(poll_interval);
+      } else if (in_flight.front()->m_latch->wait_for(poll_interval)) {
+        const auto &batch = in_flight.front()->m_batch;
+        auto &results = in_flight.front()->m_results;
+        auto n_expected = static_cast<std::size_t>(
+            (batch.m_last_toy - batch.m_first_toy)) * energies.size();
+        if (results.size() < n_expected) {
+          // Toys were skipped because the run got cancelled
+          queue->release(batch);
+          in_flight.pop_front();
+          continue;
+        }
+        // Result files are ordered by energy and toy index
+        std::sort(results.begin(), results.end(),
+                  [](const InfoResult &a, const InfoResult &b) {
+                    return std::make_pair(a.first.m_energy,
+                                          a.first.m_toy_index) <
+                           std::make_pair(b.first.m_energy,
+                                          b.first.m_toy_index);
+                  });
+        queue->complete(batch, results);
+        in_flight.pop_front();
+      }
+      queue->heartbeat();
+      claim_batches();
+    }
+  } catch (...) {
+    // Don't leave tasks behind that reference this stack frame, and give
+    // the unfinished batches back so other processes don't wait out the
+    // claim timeout
+    for (auto &queued : in_flight) {
+      try {
+        queued->m_latch->wait();
+      } catch (...) {
+      }
+      queue->release(queued->m_batch);
+    }
+    throw;
+  }
+  spdlog::debug("ParallelRunner: Queued campaign is complete.");
+  this->report_timing(workspaces, start);
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+std::map<int, PrEW::Fit::ResultVec>
+ParallelRunner<SetupClass, Policy>::run_collect_stopped(
+    const std::vector<int> &energies, StoppingPolicy *stopping,
+    int n_threads) const {
+  /** Run toys until the stopping policy is satisfied and collect the results
+      of all completed toys, ordered by toy index.
+   **/
+  this->check_stopping(stopping);
+  using IndexedResult = std::pair<int, PrEW::Fit::FitResult>;
+  std::map<int, std::vector<IndexedResult>> indexed_map{};
+  for (const auto &energy : energies) {
+    indexed_map[energy] = {};
+  }
+  std::mutex results_mutex{};
+  ResultHandler handler = [&indexed_map,
+                           &results_mutex](const Output::ToyInfo &info,
+                                           PrEW::Fit::FitResult &&result) {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    indexed_map.at(info.m_energy).emplace_back(info.m_toy_index,
+                                               std::move(result));
+  };
+
+  {
+    auto pool = this->make_pool(n_threads);
+    this->run_until_stopped(energies, stopping, handler, pool.get());
+  }
+
+  std::map<int, PrEW::Fit::ResultVec> results_map{};
+  for (auto &energy_results : indexed_map) {
+    auto &indexed = energy_results.second;
+    std::sort(indexed.begin(), indexed.end(),
+              [](const IndexedResult &a, const IndexedResult &b) {
+                return a.first < b.first;
+              });
+    auto &results = results_map[energy_results.first];
+    results.reserve(indexed.size());
+    for (auto &indexed_result : indexed) {
+      results.push_back(std::move(indexed_result.second));
+    }
+    spdlog::info("ParallelRunner: Completed {} toys @ E={}.", results.size(),
+                 energy_results.first);
+  }
+  return results_map;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::run_into_sink(
+    const PoolRun &run, Output::ResultSink *sink, int n_threads) const {
+  /** Do the given run on a fresh pool and stream the results into the sink
+      through a writer thread, so that neither memory nor waiting on output
+      grows with the number of toys.
+   **/
+  Output::AsyncSink async_sink(sink);
+  ResultHandler handler = [&async_sink](const Output::ToyInfo &info,
+                                        PrEW::Fit::FitResult &&result) {
+    async_sink.consume(info, std::move(result));
+  };
+
+  {
+    auto pool = this->make_pool(n_threads);
+    run(handler, pool.get());
+  }
+  async_sink.finish();
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::submit_toy_chunk(
+    int energy, ToyChunk chunk, const ResultHandler *handler,
+    std::vector<WorkerWorkspaces> *workspaces, Parallel::WorkStealingPool *pool,
+    Parallel::Latch *latch, const Parallel::CancelToken *stop) const {
+  /** Queue a single task that performs the toy fits of the given chunk in the
+      workspace of the executing worker and hands each result to the handler.
+      Toys that have not started when the given stop token or the runner's
+      cancel token are cancelled are skipped.
+      Exceptions are handed to the latch and rethrown by the waiting thread.
+   **/
+  ToyTiming::Clock::time_point submitted{};
+  if (ToyTiming::enabled) {
+    submitted = ToyTiming::Clock::now();
+  }
+  pool->submit([this, energy, chunk, handler, workspaces, latch, stop,
+                submitted] {
+    std::exception_ptr error{};
+    try {
+      auto worker = Parallel::WorkStealingPool::current_worker_index();
+      auto *workspace = this->get_workspace(
+          energy, &workspaces->at(static_cast<std::size_t>(worker)));
+      if (ToyTiming::enabled) {
+        workspace->get_timings()->add(ToyTiming::QueueWait,
+                                      ToyTiming::Clock::now() - submitted);
+      }
+      for (int t = chunk.first; t < chunk.second; t++) {
+        if ((stop && stop->is_cancelled()) || this->is_cancelled()) {
+          break;
+        }
+        (*handler)({energy, t}, this->single_fit_task(energy, t, workspace));
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+    latch->count_down(error);
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+ToyWorkspace *
+ParallelRunner<SetupClass, Policy>::get_workspace(
+    int energy, WorkerWorkspaces *workspaces) const {
+  /** Find the workspace of the given energy, build it if it doesn't exist yet.
+   **/
+  auto &workspace = (*workspaces)[energy];
+  if (!workspace) {
+    auto start = ToyTiming::Clock::now();
+    if (m_numa_local_data) {
+      const auto &node_data =
+          this->get_node_data(Parallel::CpuTopology::current_node());
+      workspace = std::make_unique<ToyWorkspace>(
+          node_data.m_data_connector, node_data.m_expected_distrs.at(energy),
+          node_data.m_pars.at(energy), &node_data.m_toy_plans.at(energy));
+    } else {
+      workspace = std::make_unique<ToyWorkspace>(
+          m_data_connector, m_expected_distrs.at(energy), m_pars.at(energy),
+          &m_toy_plans.at(energy));
+    }
+    if (ToyTiming::enabled) {
+      workspace->get_timings()->add(ToyTiming::Workspace,
+                                    ToyTiming::Clock::now() - start);
+    }
+  }
+  return workspace.get();
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+void ParallelRunner<SetupClass, Policy>::report_timing(
+    const std::vector<WorkerWorkspaces> &workspaces,
+    ToyTiming::Clock::time_point start) const {
+  /** Fill the timing report from the stage timings in the workspaces of a
+      finished run, merged per energy and per worker.
+   **/
+  if (!ToyTiming::enabled || !m_timing_report) {
+    return;
+  }
+  auto &report = *m_timing_report;
+  report = ToyTiming::TimingReport{};
+  report.m_wall_time =
+      std::chrono::duration<double>(ToyTiming::Clock::now() - start).count();
+  report.m_stages = {"queue_wait", "workspace", "fluctuation", "preparation"};
+  for (std::size_t m = 0; m < m_minimizer_infos.size(); m++) {
+    std::string name = "minimizer";
+    for (const auto &naming : Names::MinimizerNaming::minimizer_naming_map) {
+      if (naming.second == m_minimizer_infos[m].m_type) {
+        name = naming.first;
+      }
+    }
+    report.m_stages.push_back(std::to_string(m) + "_" + name);
+  }
+
+  std::map<int, ToyTiming::StageTimings> energy_timings{};
+  for (const auto &worker_workspaces : workspaces) {
+    ToyTiming::StageTimings worker_timings{};
+    for (const auto &energy_workspace : worker_workspaces) {
+      const auto &timings = *(energy_workspace.second->get_timings());
+      worker_timings.merge(timings);
+      energy_timings[energy_workspace.first].merge(timings);
+    }
+    report.m_workers.push_back(
+        ToyTiming::summarize(worker_timings, report.m_stages.size()));
+  }
+  for (const auto &energy_timing : energy_timings) {
+    report.m_energies[energy_timing.first] =
+        ToyTiming::summarize(energy_timing.second, report.m_stages.size());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
 PrEW::Fit::FitResult
-ParallelRunner<SetupClass>::single_fit_task(int energy) const {
+ParallelRunner<SetupClass, Policy>::single_fit_task(
+    int energy, int toy_index, ToyWorkspace *workspace) const {
   /** Single complete toy fit task.
-      Creates a poisson fluctuated toy measurement, sets up the fit container,
-      performs the actual fit and returns its result.
+      Creates a poisson fluctuated toy measurement, sets up the fit container
+      in the given workspace, performs the actual fit and returns its result.
+      All random numbers come from the toy's own counter-based streams.
   **/
-  spdlog::debug("ParallelRunner: Create toy measurement @ E={}.", energy);
-  auto distrs = m_toy_gen.get_fluctuated_distrs(energy);
-  auto pars = m_pars.at(energy);
-  PrEW::ToyMeas::ParFlct::fluctuate_constrs(pars);
+  if (m_tracer) {
+    m_tracer->toy_start(energy, toy_index);
+  }
+  ToyTiming::Clock::time_point stage_start{};
+  auto end_stage = [this, &stage_start, workspace](std::size_t stage) {
+    if (ToyTiming::enabled) {
+      auto now = ToyTiming::Clock::now();
+      workspace->get_timings()->add(stage, now - stage_start);
+      stage_start = now;
+    }
+    if (m_tracer) {
+      m_tracer->stage_end(stage);
+    }
+  };
+  if (ToyTiming::enabled) {
+    stage_start = ToyTiming::Clock::now();
+  }
 
-  spdlog::debug("ParallelRunner: Set up fit container @ E={}.", energy);
-  PrEW::Fit::FitContainer container{};
-  m_data_connector.fill_fit_container(distrs, pars, &container);
+  using Random::ToyFlct::Domain;
+  auto meas_rng = Random::ToyFlct::toy_stream(m_seed, energy, toy_index,
+                                              Domain::Measurement);
+  auto constr_rng = Random::ToyFlct::toy_stream(m_seed, energy, toy_index,
+                                                Domain::Constraints);
 
-  // If requested remove bins according to selector
-  if (m_use_selector) {
-    m_bin_selector.remove_bins(&container);
+  // Fluctuate into the workspace buffers, the prebuilt container (with the bin
+  // selection already applied) only gets its values overwritten
+  Random::ToyFlct::fluctuate_bins(workspace->get_plan()->get_expected_bins(),
+                                  workspace->get_measured_buffer(), meas_rng);
+  end_stage(ToyTiming::Fluctuation);
+
+  auto *container = workspace->prepare_toy(constr_rng);
+  end_stage(ToyTiming::Preparation);
+
+  auto final_result = this->minimize_chain(container, workspace);
+  if (!m_result_fidelity.is_full()) {
+    m_result_fidelity.trim(&final_result, m_kept_pars.at(energy));
   }
 
-  // Minimize with all given minimizers, save only the results of the last one
-  PrEW::Fit::FitResult final_result{};
-  for (const auto &minuit_factory : m_minuit_factories) {
-    final_result = this->single_minimization(&container, minuit_factory);
+  if (m_tracer) {
+    m_tracer->toy_end(static_cast<int>(final_result.m_status));
+  }
+  return final_result;
+}
+
+//------------------------------------------------------------------------------
+
+template <class SetupClass, class Policy>
+PrEW::Fit::FitResult ParallelRunner<SetupClass, Policy>::minimize_chain(
+    PrEW::Fit::FitContainer *container_ptr, ToyWorkspace *workspace) const {
+  /** Minimize the prepared container with all given minimizers (within the
+      toy budget if one is set), save only the result of the last one.
+   **/
+  if (m_toy_budget.is_limited()) {
+    return this->budgeted_minimization(container_ptr, workspace);
   }
 
-  spdlog::info("ParallelRunner: Single minimization @ E={} finished.", energy);
+  PrEW::Fit::FitResult final_result{};
+  for (std::size_t m = 0; m < m_minuit_factories.size(); m++) {
+    ToyTiming::Clock::time_point start{};
+    if (ToyTiming::enabled) {
+      start = ToyTiming::Clock::now();
+    }
+    final_result =
+        this->single_minimization(container_ptr, m_minuit_factories[m]);
+    if (ToyTiming::enabled) {
+      workspace->get_timings()->add(ToyTiming::NFixedStages + m,
+                                    ToyTiming::Clock::now() - start);
+    }
+    if (m_tracer) {
+      m_tracer->minimizer_end(m, static_cast<int>(final_result.m_status));
+    }
+  }
   return final_result;
 }
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
-PrEW::Fit::FitResult ParallelRunner<SetupClass>::single_minimization(
+template <class SetupClass, class Policy>
+PrEW::Fit::FitResult ParallelRunner<SetupClass, Policy>::single_minimization(
     PrEW::Fit::FitContainer *container_ptr,
     const PrEW::Fit::MinuitFactory &minuit_factory) const {
   /** Start a minimisation on the given fit container with the given Minuit2
-      minimizer and the PrEW minimizer that was requested at initialisation.
-      Return the result.
+      minimizer and the PrEW minimizer of the minimizer policy.
+      Return the result as extracted by the result policy.
   **/
-
-  spdlog::debug("ParallelRunner: Create minimizer: {}.", m_prew_minimizer);
-  if (m_prew_minimizer == "ChiSquared") {
-    auto minimizer = PrEW::Fit::ChiSqMinimizer(container_ptr, minuit_factory);
-    return this->single_minimization(&minimizer);
-  } else if (m_prew_minimizer == "PoissonNLL") {
-    auto minimizer =
-        PrEW::Fit::PoissonNLLMinimizer(container_ptr, minuit_factory);
-    return this->single_minimization(&minimizer);
-  } else {
-    throw std::invalid_argument(
-        ("Unknown PrEW minimizer type " + m_prew_minimizer).c_str());
-  }
+  return m_minimizer.template minimize<typename Policy::Result>(
+      container_ptr, minuit_factory);
 }
 
 //------------------------------------------------------------------------------
 
-template <class SetupClass>
-template <class MinimizerClass>
-PrEW::Fit::FitResult ParallelRunner<SetupClass>::single_minimization(
-    MinimizerClass *minimizer) const {
-  /** Perform a minimisation task on the given minimizer and return the result.
-   **/
+template <class SetupClass, class Policy>
+PrEW::Fit::FitResult ParallelRunner<SetupClass, Policy>::budgeted_minimization(
+    PrEW::Fit::FitContainer *container_ptr, ToyWorkspace *workspace) const {
+  /** Minimize with all given minimizers within the toy budget.
+      Each minimizer gets the FCN calls that are left as its call limit, the
+      time that is left is converted into calls using the worker's estimate of
+      the time per call.
+      If a minimizer hits a limit set by the budget, or no time is left for the
+      next one, the chain is aborted and the toy is marked as timed out.
+      A toy that overran the time limit anyway (see ToyBudget) is marked as
+      timed out as well.
+  **/
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  unsigned int calls_used = 0;
+
+  PrEW::Fit::FitResult result{};
+  bool timed_out = false;
+  for (std::size_t m = 0; m < m_minimizer_infos.size(); m++) {
+    const auto &min_info = m_minimizer_infos[m];
+    unsigned int max_calls = min_info.m_max_fcn_calls;
+    bool budget_limited = false;
+    auto limit_calls = [&max_calls, &budget_limited](double calls) {
+      if (calls < max_calls) {
+        max_calls = static_cast<unsigned int>(std::max(calls, 1.0));
+        budget_limited = true;
+      }
+    };
+
+    if (m_toy_budget.m_max_fcn_calls > 0) {
+      if (calls_used >= m_toy_budget.m_max_fcn_calls) {
+        timed_out = true;
+        break;
+      }
+      limit_calls(m_toy_budget.m_max_fcn_calls - calls_used);
+    }
+    if (m_toy_budget.m_max_time.count() > 0) {
+      std::chrono::duration<double> time_left =
+          m_toy_budget.m_max_time - (Clock::now() - start);
+      if (time_left.count() <= 0) {
+        timed_out = true;
+        break;
+      }
+      if (workspace->get_seconds_per_call() <= 0) {
+        // First toy of this worker, nothing timed yet
+        workspace->calibrate_calls();
+      }
+      limit_calls(time_left.count() / workspace->get_seconds_per_call());
+    }
+
+    auto step_start = Clock::now();
+    result = this->single_minimization(
+        container_ptr,
+        PrEW::Fit::MinuitFactory(min_info.m_type, max_calls,
+                                 min_info.m_max_iters, min_info.m_tolerance));
+    auto n_calls = std::max(static_cast<int>(result.m_n_calls), 0);
+    auto step_duration = Clock::now() - step_start;
+    workspace->add_timing(step_duration, n_calls);
+    if (ToyTiming::enabled) {
+      workspace->get_timings()->add(ToyTiming::NFixedStages + m,
+                                    step_duration);
+    }
+    if (m_tracer) {
+      m_tracer->minimizer_end(m, static_cast<int>(result.m_status));
+    }
+    calls_used += static_cast<unsigned int>(n_calls);
 
-  spdlog::debug("ParallelRunner: Start minimization.");
-  minimizer->minimize();
+    if (budget_limited && (static_cast<unsigned int>(n_calls) >= max_calls)) {
+      timed_out = true;
+      break;
+    }
+  }
 
-  spdlog::debug("ParallelRunner: Minimization finished.");
-  return minimizer->get_result();
+  std::chrono::duration<double> duration = Clock::now() - start;
+  if ((m_toy_budget.m_max_time.count() > 0) &&
+      (duration > m_toy_budget.m_max_time)) {
+    timed_out = true;
+  }
+  if (timed_out && !m_tracer) {
+    spdlog::warn("ParallelRunner: Toy fit timed out after {} FCN calls and "
+                 "{:.1f}s.",
+                 calls_used, duration.count());
+  }
+  if (timed_out) {
+    result.m_status = ToyStatus::TimedOut;
+  }
+  return result;
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,52 @@
+#ifndef LIB_RESULTFIDELITY_H
+#define LIB_RESULTFIDELITY_H 1
+
+#include <SetupHelp/ParOrder.h>
+
+// Includes from PrEW
+#include "Fit/FitPar.h"
+#include "Fit/FitResult.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Runners {
+
+struct ResultFidelity {
+  /** What is kept of every toy fit result.
+      The level decides which quantities are kept, the categories (see
+      SetupHelp/ParOrder.h, e.g. "TGCs" or "Pols") for which parameters. No
+      categories means all parameters.
+      FCN minimum, EDM, calls and status are always kept. Results of the
+      dropped parameters or quantities are released in the worker right after
+      the fit, so they are never collected, sent to sinks or written.
+      The fidelity only trims the stored results, the fits are the same for
+      all levels: PrEW's minimizers decide the Minuit2 strategy and whether
+      Hesse runs, so uncertainties are still computed with Values and only
+      dropped afterwards.
+   **/
+  enum Level {
+    Values,          // Initial and final parameter values
+    ValuesAndErrors, // + initial and final uncertainties
+    Full             // + correlation matrix
+  };
+
+  Level m_level{Full};
+  std::vector<std::string> m_categories{};
+  SetupHelp::ParOrder::IDMap m_id_map{SetupHelp::ParOrder::default_par_map};
+
+  bool is_full() const;
+  bool keeps_uncertainties() const;
+
+  // Indices of the kept parameters, in fit order
+  std::vector<std::size_t> kept_pars(const PrEW::Fit::ParVec &pars) const;
+  void trim(PrEW::Fit::FitResult *result,
+            const std::vector<std::size_t> &kept_pars) const;
+};
+
+} // namespace Runners
+} // namespace PrEWUtils
+
+#endif
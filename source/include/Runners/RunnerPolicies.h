@@ -0,0 +1,160 @@
+#ifndef LIB_RUNNERPOLICIES_H
+#define LIB_RUNNERPOLICIES_H 1
+
+#include <DataHelp/BinSelector.h>
+
+// Includes from PrEW
+#include "Fit/ChiSqMinimizer.h"
+#include "Fit/FitContainer.h"
+#include "Fit/FitResult.h"
+#include "Fit/MinuitFactory.h"
+#include "Fit/PoissonNLLMinimizer.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace PrEWUtils {
+namespace Runners {
+
+namespace Policies {
+/** Compile-time policies that fix parts of the ParallelRunner behaviour.
+    Own policies can be plugged in by providing a class with the same
+    interface as the ones below:
+
+    Minimizer policy:
+      Constructor(const std::string & prew_minimizer)
+      template <class ResultPolicy> PrEW::Fit::FitResult minimize(
+        PrEW::Fit::FitContainer *, const PrEW::Fit::MinuitFactory &) const
+    Selection policy:
+      static constexpr bool allows_selector
+      void set(DataHelp::BinSelector selector)   (only if allows_selector)
+      const DataHelp::BinSelector * get() const
+    Result policy:
+      template <class MinimizerClass>
+      static PrEW::Fit::FitResult extract(const MinimizerClass &)
+ **/
+
+//------------------------------------------------------------------------------
+// Result policies
+
+struct FullResult {
+  /** Return the full PrEW result of the minimizer.
+   **/
+  template <class MinimizerClass>
+  static PrEW::Fit::FitResult extract(const MinimizerClass &minimizer) {
+    return minimizer.get_result();
+  }
+};
+
+//------------------------------------------------------------------------------
+// Minimizer policies
+
+template <class MinimizerClass, class ResultPolicy>
+PrEW::Fit::FitResult run_minimizer(PrEW::Fit::FitContainer *container,
+                                   const PrEW::Fit::MinuitFactory &factory) {
+  /** Perform a minimisation on the container with the given PrEW minimizer
+      and extract the result according to the result policy.
+   **/
+  MinimizerClass minimizer(container, factory);
+  minimizer.minimize();
+  return ResultPolicy::extract(minimizer);
+}
+
+template <class MinimizerClass> class FixedMinimizer {
+  /** Minimizer policy for a PrEW minimizer fixed at compile time.
+      The name passed at construction must match the minimizer.
+   **/
+
+public:
+  FixedMinimizer(const std::string &prew_minimizer);
+
+  template <class ResultPolicy>
+  PrEW::Fit::FitResult minimize(PrEW::Fit::FitContainer *container,
+                                const PrEW::Fit::MinuitFactory &factory) const {
+    return run_minimizer<MinimizerClass, ResultPolicy>(container, factory);
+  }
+
+  static std::string name();
+};
+
+using ChiSquared = FixedMinimizer<PrEW::Fit::ChiSqMinimizer>;
+using PoissonNLL = FixedMinimizer<PrEW::Fit::PoissonNLLMinimizer>;
+
+class RuntimeMinimizer {
+  /** Minimizer policy that selects the PrEW minimizer by name at run time.
+      The name is resolved once at construction, the hot path only switches
+      on the resolved type.
+      Allowed PrEW minimizers are:
+        ChiSquared
+        PoissonNLL
+   **/
+  enum class Type { ChiSquared, PoissonNLL };
+  Type m_type{};
+
+public:
+  RuntimeMinimizer(const std::string &prew_minimizer);
+
+  template <class ResultPolicy>
+  PrEW::Fit::FitResult minimize(PrEW::Fit::FitContainer *container,
+                                const PrEW::Fit::MinuitFactory &factory) const {
+    switch (m_type) {
+    case Type::ChiSquared:
+      return run_minimizer<PrEW::Fit::ChiSqMinimizer, ResultPolicy>(container,
+                                                                    factory);
+    case Type::PoissonNLL:
+      return run_minimizer<PrEW::Fit::PoissonNLLMinimizer, ResultPolicy>(
+          container, factory);
+    }
+    throw std::logic_error("RuntimeMinimizer: Invalid type!");
+  }
+};
+
+//------------------------------------------------------------------------------
+// Selection policies
+
+class OptionalSelection {
+  /** Bins are only removed if a bin selector was set.
+   **/
+  bool m_use_selector{false};
+  DataHelp::BinSelector m_bin_selector{};
+
+public:
+  static constexpr bool allows_selector = true;
+
+  void set(DataHelp::BinSelector selector);
+  const DataHelp::BinSelector *get() const;
+};
+
+struct NoSelection {
+  /** All bins are always used, setting a selector doesn't compile.
+   **/
+  static constexpr bool allows_selector = false;
+
+  const DataHelp::BinSelector *get() const;
+};
+
+//------------------------------------------------------------------------------
+// Combination used by the runner
+
+template <class MinimizerPolicy = RuntimeMinimizer,
+          class SelectionPolicy = OptionalSelection,
+          class ResultPolicy = FullResult>
+struct RunnerPolicy {
+  /** Bundle of the policies that parametrise a ParallelRunner.
+   **/
+  using Minimizer = MinimizerPolicy;
+  using Selection = SelectionPolicy;
+  using Result = ResultPolicy;
+};
+
+using DefaultPolicy = RunnerPolicy<>;
+
+} // namespace Policies
+
+} // namespace Runners
+} // namespace PrEWUtils
+
+// Template definitions
+#include <Runners/RunnerPolicies.tpp>
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef LIB_RUNNERPOLICIES_TPP
+#define LIB_RUNNERPOLICIES_TPP 1
+
+#include <Runners/RunnerPolicies.h>
+
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Runners {
+
+//------------------------------------------------------------------------------
+
+template <class MinimizerClass>
+Policies::FixedMinimizer<MinimizerClass>::FixedMinimizer(
+    const std::string &prew_minimizer) {
+  /** Check that the requested minimizer is the one fixed at compile time.
+   **/
+  if (prew_minimizer != name()) {
+    throw std::invalid_argument("Runner compiled for PrEW minimizer " + name() +
+                                " but " + prew_minimizer + " was requested!");
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <> inline std::string Policies::ChiSquared::name() {
+  return "ChiSquared";
+}
+
+template <> inline std::string Policies::PoissonNLL::name() {
+  return "PoissonNLL";
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Runners
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef LIB_STOPPINGPOLICY_H
+#define LIB_STOPPINGPOLICY_H 1
+
+#include <Output/ResultSink.h>
+
+// Includes from PrEW
+#include "Fit/FitResult.h"
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Runners {
+
+class StoppingPolicy {
+  /** Interface for rules that decide when a toy campaign has enough toys.
+      The runner starts the policy with the energies of the campaign, hands
+      every finished toy to the policy and regularly asks it whether to stop.
+      Calls are serialised by the runner, implementations don't need to be
+      thread-safe.
+      Policies that read the uncertainties of the results must say so, the
+      runner refuses them if its result fidelity drops the uncertainties.
+  **/
+
+public:
+  virtual ~StoppingPolicy() = default;
+
+  virtual void start(const std::vector<int> & /*energies*/) {}
+  virtual void add_result(const Output::ToyInfo &info,
+                          const PrEW::Fit::FitResult &result) = 0;
+  virtual bool should_stop() const = 0;
+  virtual bool needs_uncertainties() const { return false; }
+};
+
+//------------------------------------------------------------------------------
+
+struct RunningMoments {
+  /** Online mean and central moments up to fourth order of a sample.
+   **/
+  double m_n{};
+  double m_mean{};
+  double m_m2{};
+  double m_m3{};
+  double m_m4{};
+
+  void add(double x);
+
+  double get_width() const;
+  double get_kurtosis() const;
+};
+
+//------------------------------------------------------------------------------
+
+class PrecisionStop : public StoppingPolicy {
+  /** Stop once the mean and the width of the distribution of every parameter
+      are known to a target precision relative to that width, at every
+      energy.
+      The uncertainty on the mean is width/sqrt(n), the uncertainty on the
+      width is estimated from the sample kurtosis.
+      Parameters without spread (e.g. fixed ones) are ignored, an energy
+      without any finished toy is never precise.
+  **/
+
+public:
+  enum class Quantity {
+    Values, // Spread of the fitted values
+    Pulls   // (final - initial value) / final uncertainty
+  };
+
+private:
+  double m_rel_precision{};
+  Quantity m_quantity{};
+  int m_min_toys{};
+  int m_max_toys{};
+
+  std::map<int, std::vector<RunningMoments>> m_moments{}; // Per energy
+  mutable bool m_warned_max{false}; // Only warn once per run
+
+public:
+  // Constructors
+  PrecisionStop(double rel_precision, Quantity quantity = Quantity::Pulls,
+                int min_toys = 20, int max_toys = 0);
+
+  void start(const std::vector<int> &energies) override;
+  void add_result(const Output::ToyInfo &info,
+                  const PrEW::Fit::FitResult &result) override;
+  bool should_stop() const override;
+  bool needs_uncertainties() const override;
+
+  // Access functions
+  const std::map<int, std::vector<RunningMoments>> &get_moments() const;
+
+protected:
+  bool is_precise(const RunningMoments &moments) const;
+};
+
+//------------------------------------------------------------------------------
+
+class WallClockStop : public StoppingPolicy {
+  /** Stop once a given wall-clock time has passed since the campaign started.
+   **/
+
+  using Clock = std::chrono::steady_clock;
+
+  std::chrono::duration<double> m_budget{};
+  Clock::time_point m_start{};
+
+public:
+  // Constructors
+  WallClockStop(std::chrono::duration<double> budget);
+
+  void start(const std::vector<int> &energies) override;
+  void add_result(const Output::ToyInfo &info,
+                  const PrEW::Fit::FitResult &result) override;
+  bool should_stop() const override;
+};
+
+//------------------------------------------------------------------------------
+
+class AnyStop : public StoppingPolicy {
+  /** Stop as soon as any of the given policies wants to stop.
+      The policies are not owned.
+  **/
+
+  std::vector<StoppingPolicy *> m_policies{};
+
+public:
+  // Constructors
+  AnyStop(std::vector<StoppingPolicy *> policies);
+
+  void start(const std::vector<int> &energies) override;
+  void add_result(const Output::ToyInfo &info,
+                  const PrEW::Fit::FitResult &result) override;
+  bool should_stop() const override;
+  bool needs_uncertainties() const override;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace Runners
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef LIB_TOYBUDGET_H
+#define LIB_TOYBUDGET_H 1
+
+#include <chrono>
+
+namespace PrEWUtils {
+namespace Runners {
+
+struct ToyBudget {
+  /** Limits on the effort spent on a single toy fit, over all minimizers of
+      the chain. A value of zero means no limit.
+      The FCN call limit is a hard limit on the calls of each minimization.
+      The time limit is only approximate: the FCN loop runs inside PrEW, so
+      the time is turned into a call limit using the worker's running estimate
+      of the time per FCN call (calibrated before a worker's first fit), and
+      it is checked between the minimizers of the chain. A minimization can
+      overrun it when the estimate is off, and whatever PrEW does after the
+      minimization itself (e.g. Hesse) is not bounded at all.
+      Toys that run out of budget, or took longer than the time limit, are
+      kept with status ToyStatus::TimedOut.
+   **/
+  unsigned int m_max_fcn_calls{0};
+  std::chrono::duration<double> m_max_time{0};
+
+  bool is_limited() const;
+};
+
+namespace ToyStatus {
+/** Fit result status codes set by the runner, chosen outside of the range of
+    Minuit2 status codes.
+ **/
+constexpr int TimedOut = 100;
+} // namespace ToyStatus
+
+//------------------------------------------------------------------------------
+// Definitions
+//------------------------------------------------------------------------------
+
+inline bool ToyBudget::is_limited() const {
+  return (m_max_fcn_calls > 0) || (m_max_time.count() > 0);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Runners
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef LIB_TOYPLAN_H
+#define LIB_TOYPLAN_H 1
+
+#include <DataHelp/BinSelector.h>
+#include <Random/Philox.h>
+
+// Includes from PrEW
+#include "Connect/DataConnector.h"
+#include "Data/PredDistr.h"
+#include "Fit/FitContainer.h"
+#include "Fit/FitPar.h"
+
+#include <vector>
+
+namespace PrEWUtils {
+namespace Runners {
+
+class ToyPlan {
+  /** Compiled description of the toys at a single energy.
+      Everything the runner needs to turn a linked fit container into a toy is
+      resolved once into flat arrays and integer indices: the expected bin
+      contents, the bins surviving the selection, the parameter start values
+      and the constrained parameters.
+      Setting up a toy from the plan involves no name lookups, copies of
+      parameter objects or allocations.
+      Relies on the connector filling the container bins distribution by
+      distribution and bin by bin, in the order of the given distributions,
+      and deriving the measured uncertainty of a bin as the square root of
+      its content (checked when compiling the plan). Toys overwrite both.
+  **/
+
+  std::vector<double> m_expected_bins{}; // Flat, signal + background
+  DataHelp::BinSelector::BinMask m_bin_mask{}; // Selection, flat bins
+  std::vector<int> m_kept_bins{};        // Flat index of each fitted bin
+
+  std::vector<double> m_start_vals{};
+  std::vector<double> m_start_uncs{};
+
+  std::vector<int> m_constr_indices{};
+  std::vector<double> m_constr_vals{};
+  std::vector<double> m_constr_uncs{};
+
+public:
+  // Constructors
+  ToyPlan() {}
+  ToyPlan(const PrEW::Connect::DataConnector &connector,
+          const PrEW::Data::PredDistrVec &expected,
+          const PrEW::Fit::ParVec &pars,
+          const DataHelp::BinSelector *selector = nullptr);
+
+  // Access functions
+  const std::vector<double> &get_expected_bins() const;
+  const std::vector<int> &get_kept_bins() const;
+
+  // Modify where the toy fits start
+  void set_start(const std::vector<double> &vals,
+                 const std::vector<double> &uncs);
+
+  // Instantiating containers and toys
+  void compact_bins(PrEW::Fit::FitContainer *container) const;
+  void set_toy(PrEW::Fit::FitContainer *container,
+               const std::vector<double> &measured,
+               Random::Philox &constr_rng) const;
+  void set_asimov(PrEW::Fit::FitContainer *container) const;
+
+  // Flatten distributions in the container bin order
+  static std::vector<double>
+  flatten_bins(const PrEW::Data::PredDistrVec &distrs);
+
+protected:
+  // Internal functions
+  static void set_measurement(PrEW::Fit::FitBin *bin, double measured);
+  static void check_unc_convention(const PrEW::Fit::FitContainer &container,
+                                   const std::vector<double> &measured);
+};
+
+} // namespace Runners
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef LIB_TOYTIMING_H
+#define LIB_TOYTIMING_H 1
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Runners {
+namespace ToyTiming {
+/** Instrumentation of the stages of the toy fits.
+    Only active if compiled with PREWUTILS_TIMING defined (CMake option
+    PrEWUtils_TIMING), otherwise all timing calls compile to nothing.
+ **/
+
+#ifdef PREWUTILS_TIMING
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// Fixed stages, the minimizers of the chain follow after them
+enum Stage : std::size_t {
+  QueueWait,   // Task waiting on the pool
+  Workspace,   // Linking the container and removing bins, once per worker
+  Fluctuation, // Drawing the toy measurement
+  Preparation, // Resetting the container, fluctuating the constraints
+  NFixedStages
+};
+
+//------------------------------------------------------------------------------
+
+class DurationHistogram {
+  /** Fixed-size histogram of durations with logarithmic bins (20 per decade
+      between 0.1us and 10^4 s), so that percentiles can be estimated without
+      keeping the individual samples.
+  **/
+
+  static constexpr int bins_per_decade = 20;
+  static constexpr int min_exponent = -7;
+  static constexpr int n_bins = 11 * bins_per_decade + 2; // + under/overflow
+
+  std::array<std::size_t, n_bins> m_bins{};
+  std::size_t m_count{0};
+  double m_total{0};
+  double m_max{0};
+
+public:
+  void add(double seconds);
+  void merge(const DurationHistogram &other);
+
+  std::size_t get_count() const;
+  double get_total() const;
+  double get_max() const;
+  double get_quantile(double q) const;
+};
+
+//------------------------------------------------------------------------------
+
+class StageTimings {
+  /** Duration histograms of all stages, filled by a single worker.
+   **/
+
+  std::vector<DurationHistogram> m_stages{};
+
+public:
+  void add(std::size_t stage, Clock::duration duration);
+  void merge(const StageTimings &other);
+
+  const std::vector<DurationHistogram> &get_stages() const;
+};
+
+//------------------------------------------------------------------------------
+
+struct StageStats {
+  /** Summary of the durations of one stage, all times in seconds.
+   **/
+  std::size_t m_count{};
+  double m_total{};
+  double m_mean{};
+  double m_p50{};
+  double m_p90{};
+  double m_p99{};
+  double m_max{};
+};
+
+using StatsVec = std::vector<StageStats>; // Indexed like the stage names
+
+struct TimingReport {
+  /** Timing breakdown of a run per energy and per worker.
+   **/
+  double m_wall_time{};
+  std::vector<std::string> m_stages{};
+  std::map<int, StatsVec> m_energies{};
+  std::vector<StatsVec> m_workers{};
+
+  std::string to_json() const;
+  void write_json(const std::string &path) const;
+};
+
+StatsVec summarize(const StageTimings &timings, std::size_t n_stages);
+
+} // namespace ToyTiming
+} // namespace Runners
+} // namespace PrEWUtils
+
+#endif
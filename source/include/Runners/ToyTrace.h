@@ -0,0 +1,169 @@
+#ifndef LIB_TOYTRACE_H
+#define LIB_TOYTRACE_H 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Runners {
+namespace ToyTrace {
+/** Structured event tracing of the toy fits.
+    Every thread writes fixed-size binary events into its own lock-free ring
+    buffer, a background thread drains the buffers, appends the events to a
+    trace file and logs an aggregated progress summary at a fixed interval.
+    Workers never wait on the logger or on each other; if a buffer is full
+    the event is dropped and counted.
+ **/
+
+enum EventType : std::uint16_t {
+  ToyStart,     // New toy of the given energy and index
+  StageEnd,     // Stage (see ToyTiming::Stage) of the current toy finished
+  MinimizerEnd, // Minimizer of the chain finished, value is its status
+  ToyEnd        // Current toy finished, value is its final status
+};
+
+struct Event {
+  /** Binary trace record, written to the trace file as is.
+   **/
+  std::uint64_t m_time_ns{}; // Since the creation of the tracer
+  std::int32_t m_energy{};
+  std::int32_t m_toy_index{};
+  std::uint16_t m_type{};
+  std::uint16_t m_stage{}; // Stage or minimizer index
+  std::int32_t m_value{};
+};
+
+using EventVec = std::vector<Event>;
+
+//------------------------------------------------------------------------------
+
+class EventRing {
+  /** Single-producer single-consumer ring buffer of events.
+      The owning thread pushes, the flush thread pops.
+   **/
+
+  std::vector<Event> m_events{};
+  std::size_t m_mask{};
+
+  // Producer and consumer indices padded onto separate cache lines
+  char m_pad_0[64]{};
+  std::atomic<std::size_t> m_head{0}; // Next write, producer
+  std::atomic<std::size_t> m_n_dropped{0};
+  char m_pad_1[64]{};
+  std::atomic<std::size_t> m_tail{0}; // Next read, consumer
+
+public:
+  explicit EventRing(std::size_t capacity);
+
+  bool push(const Event &event);
+  void pop_all(EventVec *events);
+  std::size_t get_n_dropped() const;
+};
+
+//------------------------------------------------------------------------------
+
+struct EnergyProgress {
+  std::size_t m_n_started{0};
+  std::size_t m_n_finished{0};
+  std::size_t m_n_failed{0}; // Finished with non-zero status
+};
+
+struct Progress {
+  std::map<int, EnergyProgress> m_energies{};
+  std::size_t m_n_dropped{0};
+  double m_elapsed{0}; // Seconds since the creation of the tracer
+};
+
+//------------------------------------------------------------------------------
+
+class Tracer {
+  /** Collects the trace events of all threads.
+      The events of a toy are written by the thread fitting it, between the
+      ToyStart and ToyEnd events of that toy.
+      A tracer must outlive the runs using it. Rings of threads that exited
+      (e.g. the workers of a finished run) are reused by new threads, so the
+      number of rings is bounded by the number of threads tracing at once.
+   **/
+
+  struct ThreadRing {
+    std::unique_ptr<EventRing> m_ring{};
+    bool m_in_use{true}; // Owned by a live thread
+    std::int32_t m_energy{}; // Current toy of the thread
+    std::int32_t m_toy_index{};
+  };
+
+  struct ThreadCache {
+    /** Rings of one thread, by tracer ID. When the thread exits they are
+        handed back to the tracers that are still alive.
+     **/
+    std::vector<std::pair<std::uint64_t, ThreadRing *>> m_rings{};
+    ~ThreadCache();
+  };
+
+  std::uint64_t m_id{}; // Unique, identifies the tracer in thread caches
+  std::size_t m_ring_capacity{};
+  std::chrono::steady_clock::time_point m_start{};
+  std::chrono::milliseconds m_progress_interval{};
+
+  std::mutex m_rings_mutex{};
+  std::vector<std::unique_ptr<ThreadRing>> m_rings{};
+
+  std::ofstream m_file{};
+  mutable std::mutex m_progress_mutex{};
+  Progress m_progress{};
+
+  std::mutex m_flush_mutex{};
+  std::condition_variable m_wake{};
+  bool m_stopping{false};
+  std::thread m_flush_thread{};
+
+public:
+  // Constructors
+  explicit Tracer(
+      const std::string &path = "",
+      std::chrono::milliseconds progress_interval = std::chrono::seconds(10),
+      std::size_t ring_capacity = 1 << 14);
+  ~Tracer();
+
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+
+  // Recording events on the calling thread
+  void toy_start(int energy, int toy_index);
+  void stage_end(std::size_t stage);
+  void minimizer_end(std::size_t minimizer, int status);
+  void toy_end(int status);
+
+  // Access functions
+  Progress get_progress() const;
+
+  // Reading trace files
+  static EventVec read_events(const std::string &path);
+
+protected:
+  // Internal functions
+  static ThreadCache &thread_cache();
+  ThreadRing *local_ring();
+  void release_ring(ThreadRing *ring);
+  void record(ThreadRing *ring, EventType type, std::size_t stage,
+              int value);
+  void flush_loop();
+  void flush();
+  void log_progress() const;
+};
+
+} // namespace ToyTrace
+} // namespace Runners
+} // namespace PrEWUtils
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef LIB_TOYWORKSPACE_H
+#define LIB_TOYWORKSPACE_H 1
+
+#include <Random/Philox.h>
+#include <Runners/ToyPlan.h>
+#include <Runners/ToyTiming.h>
+
+// Includes from PrEW
+#include "Connect/DataConnector.h"
+#include "Data/PredDistr.h"
+#include "Fit/FitContainer.h"
+#include "Fit/FitPar.h"
+
+#include <chrono>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Runners {
+
+class ToyWorkspace {
+  /** Fit container of a single worker at a single energy that is reused for
+      all toys this worker fits at this energy.
+      The container is linked once and reduced to the selected bins using the
+      energy's toy plan, for each toy only the measured bin contents, their
+      uncertainties and the parameter values are overwritten, so no
+      allocation or link resolution happens per toy.
+  **/
+
+  const ToyPlan *m_plan{};
+  PrEW::Fit::FitContainer m_container{};
+  std::vector<double> m_measured{}; // Buffer for the toy measurement
+  double m_seconds_per_call{0};     // 0 -> No estimate yet
+  bool m_calls_timed{false};        // Estimate from a finished minimization
+  ToyTiming::StageTimings m_timings{}; // Only filled if timing is enabled
+
+public:
+  // Constructors
+  ToyWorkspace(const PrEW::Connect::DataConnector &connector,
+               const PrEW::Data::PredDistrVec &expected,
+               const PrEW::Fit::ParVec &pars, const ToyPlan *plan);
+
+  ToyWorkspace(const ToyWorkspace &) = delete;
+  ToyWorkspace &operator=(const ToyWorkspace &) = delete;
+
+  // Per-toy access
+  const ToyPlan *get_plan() const;
+  std::vector<double> *get_measured_buffer();
+  PrEW::Fit::FitContainer *prepare_toy(Random::Philox &constr_rng);
+  PrEW::Fit::FitContainer *prepare_asimov();
+
+  // Cost estimate of a single FCN call for the toy budget
+  double get_seconds_per_call() const;
+  void calibrate_calls();
+  void add_timing(std::chrono::duration<double> duration, int n_calls);
+
+  // Stage timings of the toys done in this workspace
+  ToyTiming::StageTimings *get_timings();
+};
+
+} // namespace Runners
+} // namespace PrEWUtils
+
+#endif
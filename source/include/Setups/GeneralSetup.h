@@ -53,6 +53,8 @@ public:
   GeneralSetup(int energy);
 
   // Add input
+  void add_input(const PrEW::Data::PredDistrVec &distrs,
+                 const PrEW::Data::CoefDistrVec &coefs);
   void add_input_file(const std::string &file_path,
                       const std::string &file_type);
   void add_input_files(const std::string &dir, const std::string &file_name,
@@ -0,0 +1,55 @@
+#ifndef LIB_SYNTHETICSETUP_H
+#define LIB_SYNTHETICSETUP_H 1
+
+#include <Setups/FitModifier.h>
+#include <Setups/GeneralSetup.h>
+
+// Includes from PrEW
+#include "Data/CoefDistr.h"
+#include "Data/PredDistr.h"
+#include "GlobalVar/Chiral.h"
+
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Setups {
+namespace SyntheticSetup {
+/** Generator of synthetic inputs and setups of configurable size, so that
+    the library can be tested and benchmarked without any input files.
+    The distributions are one-dimensional in cos(theta) with a forward-backward
+    asymmetric shape, their normalisations differ between distributions and
+    chiral configurations. All values are deterministic.
+ **/
+
+struct Config {
+  /** Size of the synthetic setup and the parametrisation blocks it uses.
+   **/
+  int m_energy{250};
+  int m_n_distrs{4};
+  int m_n_bins{20}; // Per distribution and chiral configuration
+  std::vector<std::string> m_chiral_configs{
+      PrEW::GlobalVar::Chiral::eLpR, PrEW::GlobalVar::Chiral::eRpL,
+      PrEW::GlobalVar::Chiral::eLpL, PrEW::GlobalVar::Chiral::eRpR};
+
+  // Parametrisation blocks
+  bool m_use_xsections{true}; // Chiral asymmetries & total chiral xs
+  bool m_use_const_effs{true};
+  bool m_use_acc_boxes{false};
+  bool m_use_TGCs{false};  // Quadratic TGC dependence of all distributions
+  bool m_use_Af{false};    // Af modification (see make_modifier)
+};
+
+std::string distr_name(int distr_index);
+
+PrEW::Data::PredDistrVec make_distrs(const Config &config);
+PrEW::Data::CoefDistrVec make_coefs(const Config &config);
+
+GeneralSetup make_setup(const Config &config);
+FitModifier make_modifier(const Config &config);
+
+} // namespace SyntheticSetup
+} // namespace Setups
+} // namespace PrEWUtils
+
+#endif
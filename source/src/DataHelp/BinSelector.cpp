@@ -2,6 +2,10 @@
 
 #include "spdlog/spdlog.h"
 
+#include <map>
+#include <stdexcept>
+#include <utility>
+
 namespace PrEWUtils {
 namespace DataHelp {
 
@@ -12,57 +16,217 @@ BinSelector::BinSelector( double cut_val, PrEW::Fit::ParVec pars_for_cut ) :
   m_cut_val(cut_val), m_pars_for_cut(pars_for_cut) {}
 
 //------------------------------------------------------------------------------
+// Additional criteria
+
+void BinSelector::add_coord_range(
+  const std::string & distr_name,
+  int coord_index,
+  double min,
+  double max
+) {
+  /** Only keep bins of the distribution whose coordinate (of given index) lies
+      within [min, max].
+  **/
+  if ( coord_index < 0 || min > max ) {
+    throw std::invalid_argument(
+      "BinSelector: Invalid coordinate range for " + distr_name
+    );
+  }
+  m_coord_ranges.push_back( CoordRange{distr_name, coord_index, min, max} );
+}
+
+void BinSelector::add_distr_mask(
+  const std::string & distr_name,
+  const std::vector<bool> & keep
+) {
+  /** Only keep the bins of the distribution that are marked in the mask.
+      The mask needs one entry per bin of the distribution.
+  **/
+  m_distr_masks.push_back( DistrMask{distr_name, keep} );
+}
+
+bool BinSelector::uses_distrs() const {
+  /** Whether any criterion depends on the distributions.
+  **/
+  return !m_coord_ranges.empty() || !m_distr_masks.empty();
+}
+
+//------------------------------------------------------------------------------
+
+BinSelector::BinMask BinSelector::get_mask(
+  PrEW::Fit::FitContainer * container,
+  const PrEW::Data::PredDistrVec & distrs
+) const {
+  /** Combine all criteria into one mask over the bins of the container.
+      The distributions must be the ones the container was filled from, in the
+      same order (the connector fills the bins distribution by distribution).
+      Preserves the parameters of the fitcontainer.
+  **/
+  BinMask mask ( container->m_fit_bins.size(), true );
+  this->apply_cut(container, &mask);
+  if ( this->uses_distrs() ) {
+    this->apply_distr_criteria(distrs, &mask);
+  }
+  return mask;
+}
+
+std::vector<int> BinSelector::remove_bins(
+  PrEW::Fit::FitContainer * container,
+  const PrEW::Data::PredDistrVec & distrs
+) const {
+  /** Function manipulates FitContainer, it removes all bins that fail any of
+      the criteria.
+      Returns the original indices of the bins that were kept.
+  **/
+  auto mask = this->get_mask(container, distrs);
+  compact(mask, container);
+  return get_kept_indices(mask);
+}
 
-void BinSelector::remove_bins( PrEW::Fit::FitContainer * container ) const {
+std::vector<int>
+BinSelector::remove_bins( PrEW::Fit::FitContainer * container ) const {
   /** Function manipulates FitContainer, it removes all bins whose prediction
       is below the cutoff value for the set of parameters chosen for the cutoff.
       Preserves the parameters of the fitcontainer.
+      Returns the original indices of the bins that were kept.
   **/
-  int n_pars = container->m_fit_pars.size();
-  
-  // Preserve the initial parameters
-  std::vector<double> par_vals_ini (n_pars);
-  for ( int p=0; p<n_pars; p++ ) {
-    par_vals_ini[p] = container->m_fit_pars[p].m_val_mod;
+  if ( this->uses_distrs() ) {
+    throw std::logic_error(
+      "BinSelector: Selection needs the distributions of the container!"
+    );
   }
-  
+  return this->remove_bins(container, {});
+}
+
+//------------------------------------------------------------------------------
+// Applying a mask
+
+std::vector<int> BinSelector::get_kept_indices( const BinMask & mask ) {
+  /** Indices of all kept bins, in their original order.
+  **/
+  std::vector<int> ind_kept {};
+  for ( std::size_t b=0; b<mask.size(); b++ ) {
+    if ( mask[b] ) { ind_kept.push_back( static_cast<int>(b) ); }
+  }
+  return ind_kept;
+}
+
+void BinSelector::compact(
+  const BinMask & mask,
+  PrEW::Fit::FitContainer * container
+) {
+  /** Remove all bins that aren't kept by the mask in a single stable pass.
+  **/
+  auto & bins = container->m_fit_bins;
+  if ( bins.size() != mask.size() ) {
+    throw std::invalid_argument(
+      "BinSelector: Mask has " + std::to_string(mask.size()) +
+      " bins but container has " + std::to_string(bins.size())
+    );
+  }
+  std::size_t n_kept = 0;
+  for ( std::size_t b=0; b<bins.size(); b++ ) {
+    if ( !mask[b] ) { continue; }
+    if ( n_kept != b ) { bins[n_kept] = std::move(bins[b]); }
+    n_kept++;
+  }
+  bins.erase( bins.begin() + static_cast<long>(n_kept), bins.end() );
+}
+
+//------------------------------------------------------------------------------
+// Internal functions
+
+void BinSelector::apply_cut(
+  PrEW::Fit::FitContainer * container,
+  BinMask * mask
+) const {
+  /** Unmark all bins whose prediction is below the cutoff value for the set of
+      parameters chosen for the cutoff.
+      Parameters are found by name once, their values are restored afterwards.
+  **/
+  auto & fit_pars = container->m_fit_pars;
+  std::map<std::string, std::size_t> par_indices {};
+  for ( std::size_t p=0; p<fit_pars.size(); p++ ) {
+    par_indices.emplace( fit_pars[p].get_name(), p );
+  }
+
   // Set the parameters to the set given at construction
+  std::vector<std::pair<std::size_t, double>> vals_ini {};
   for ( const auto & par : m_pars_for_cut ) {
-    // Look for this parameter and replace the value when found.
-    // (Go old fashioned in this loop to be sure you know what's happening)
-    for ( int p=0; p<n_pars; p++ ) {
-      if ( container->m_fit_pars[p].get_name() == par.get_name() ) {
-        container->m_fit_pars[p].m_val_mod = par.m_val_mod;
-        break;
+    auto par_it = par_indices.find( par.get_name() );
+    if ( par_it == par_indices.end() ) { continue; }
+    auto & fit_par = fit_pars[par_it->second];
+    vals_ini.emplace_back( par_it->second, fit_par.m_val_mod );
+    fit_par.m_val_mod = par.m_val_mod;
+  }
+
+  const auto & bins = container->m_fit_bins;
+  for ( std::size_t b=0; b<bins.size(); b++ ) {
+    if ( bins[b].get_val_prd() < m_cut_val ) { (*mask)[b] = false; }
+  }
+
+  // Now reset the parameter values to how they were before the cut
+  // (backwards, in case a parameter was given twice)
+  for ( auto ini_it = vals_ini.rbegin(); ini_it != vals_ini.rend(); ++ini_it ) {
+    fit_pars[ini_it->first].m_val_mod = ini_it->second;
+  }
+}
+
+void BinSelector::apply_distr_criteria(
+  const PrEW::Data::PredDistrVec & distrs,
+  BinMask * mask
+) const {
+  /** Unmark all bins that fail a coordinate range or distribution mask.
+  **/
+  std::size_t offset = 0;
+  for ( const auto & distr : distrs ) {
+    const auto & distr_name = distr.m_info.m_distr_name;
+    std::size_t n_bins = distr.m_sig_distr.size();
+    if ( offset + n_bins > mask->size() ) {
+      throw std::invalid_argument(
+        "BinSelector: Distributions have more bins than the container!"
+      );
+    }
+
+    for ( const auto & range : m_coord_ranges ) {
+      if ( range.m_distr_name != distr_name ) { continue; }
+      auto c = static_cast<std::size_t>(range.m_coord_index);
+      for ( std::size_t b=0; b<n_bins; b++ ) {
+        const auto & coords = distr.m_coords.at(b).m_coords;
+        if ( c >= coords.size() ) {
+          throw std::invalid_argument(
+            "BinSelector: Distribution " + distr_name + " has no coordinate "
+            + std::to_string(c)
+          );
+        }
+        if ( coords[c] < range.m_min || coords[c] > range.m_max ) {
+          (*mask)[offset + b] = false;
+        }
       }
     }
-  }
-  
-  // Perform the cutoff:
-  // First check which bins need to be cut, then cut them out of bin vector
-  int n_bins = container->m_fit_bins.size();
-  std::vector<int> ind_to_remove {}; // Vector for indices to remove
-  for ( int b=0; b<n_bins; b++ ) {
-    if ( container->m_fit_bins[b].get_val_prd() < m_cut_val ) {
-      // Bin should be removed, save its index
-      ind_to_remove.push_back(b);
+
+    for ( const auto & distr_mask : m_distr_masks ) {
+      if ( distr_mask.m_distr_name != distr_name ) { continue; }
+      if ( distr_mask.m_keep.size() != n_bins ) {
+        throw std::invalid_argument(
+          "BinSelector: Mask of " + distr_name + " has wrong number of bins!"
+        );
+      }
+      for ( std::size_t b=0; b<n_bins; b++ ) {
+        if ( !distr_mask.m_keep[b] ) { (*mask)[offset + b] = false; }
+      }
     }
+
+    offset += n_bins;
   }
-  
-  // Cut them from back to front to avoid index shift before cut
-  for ( int i=ind_to_remove.size()-1; i>=0; i-- ) {
-    int b = ind_to_remove[i];
-    // Deleting the b-th element
-    container->m_fit_bins.erase( container->m_fit_bins.begin() + b ); 
-  }
-  
-  // Now reset the parameter values to how they were before bin erasure
-  for ( int p=0; p<n_pars; p++ ) {
-    container->m_fit_pars[p].m_val_mod = par_vals_ini[p];
+  if ( offset != mask->size() ) {
+    throw std::invalid_argument(
+      "BinSelector: Distributions don't match the bins of the container!"
+    );
   }
 }
 
 //------------------------------------------------------------------------------
 
 } // Namespace DataHelp
-} // Namespace PrEWUtils
\ No newline at end of file
+} // Namespace PrEWUtils
@@ -0,0 +1,157 @@
+#include <Output/AsyncSink.h>
+
+#include "spdlog/spdlog.h"
+
+#include <chrono>
+
+namespace PrEWUtils {
+namespace Output {
+
+namespace {
+// How often the target is polled while no results arrive
+const std::chrono::seconds poll_interval(1);
+} // namespace
+
+//------------------------------------------------------------------------------
+// Constructors
+
+AsyncSink::AsyncSink(ResultSink *target, std::size_t capacity)
+    : m_target(target), m_capacity(capacity > 0 ? capacity : 1) {
+  m_writer = std::thread([this] { this->write_loop(); });
+}
+
+AsyncSink::~AsyncSink() {
+  /** Make sure the writer thread is joined, errors can't be reported anymore
+      at this point.
+      A sink that wasn't finished belongs to a failed run, its target is
+      aborted instead of being finished.
+   **/
+  try {
+    this->abort();
+  } catch (const std::exception &e) {
+    spdlog::error("AsyncSink: Aborting failed: {}", e.what());
+  } catch (...) {
+    spdlog::error("AsyncSink: Aborting failed.");
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void AsyncSink::consume(const ToyInfo &info, PrEW::Fit::FitResult result) {
+  /** Queue the result for the writer thread, wait if the queue is full.
+      Rethrows the error of the writer thread once it failed, so that the run
+      stops instead of fitting toys that can't be written anymore.
+   **/
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_not_full.wait(lock, [this] {
+      return m_queue.size() < m_capacity || m_error != nullptr;
+    });
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+    m_queue.emplace_back(info, std::move(result));
+  }
+  m_not_empty.notify_one();
+}
+
+//------------------------------------------------------------------------------
+
+void AsyncSink::finish() {
+  /** Write out all queued results and finish the target sink.
+      Only does something on the first call of finish or abort.
+   **/
+  if (!this->stop_writer()) {
+    return;
+  }
+  if (m_error) {
+    std::rethrow_exception(m_error);
+  }
+  m_target->finish();
+}
+
+void AsyncSink::abort() {
+  /** Write out all queued results (e.g. finished toys for a checkpoint) and
+      abort the target sink.
+      Only does something on the first call of finish or abort.
+   **/
+  if (!this->stop_writer()) {
+    return;
+  }
+  if (m_error) {
+    try {
+      std::rethrow_exception(m_error);
+    } catch (const std::exception &e) {
+      spdlog::error("AsyncSink: Writing failed: {}", e.what());
+    } catch (...) {
+      spdlog::error("AsyncSink: Writing failed.");
+    }
+  }
+  m_target->abort();
+}
+
+//------------------------------------------------------------------------------
+// Internal functions
+
+bool AsyncSink::stop_writer() {
+  /** Let the writer thread write out the queue and join it.
+      Returns false if the writer was already stopped.
+   **/
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_finished) {
+      return false;
+    }
+    m_finished = true;
+    m_finishing = true;
+  }
+  m_not_empty.notify_one();
+  m_writer.join();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void AsyncSink::write_loop() {
+  /** Main loop of the writer thread.
+   **/
+  while (true) {
+    std::pair<ToyInfo, PrEW::Fit::FitResult> entry{};
+    bool has_entry = false;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_not_empty.wait_for(lock, poll_interval, [this] {
+        return m_finishing || !m_queue.empty();
+      });
+      if (!m_queue.empty()) {
+        entry = std::move(m_queue.front());
+        m_queue.pop_front();
+        has_entry = true;
+      } else if (m_finishing) {
+        break; // Finishing and nothing left to write
+      }
+    }
+
+    try {
+      if (has_entry) {
+        m_not_full.notify_one();
+        m_target->consume(entry.first, std::move(entry.second));
+      } else {
+        m_target->poll();
+      }
+    } catch (...) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+        m_queue.clear();
+      }
+      m_not_full.notify_all();
+      break;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Output
+} // namespace PrEWUtils
@@ -0,0 +1,137 @@
+#include <Output/CheckpointSink.h>
+#include <Output/ResultIO.h>
+#include <SetupHelp/InputHelp.h>
+
+#include "spdlog/spdlog.h"
+
+// Standard library
+#include <cerrno>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace PrEWUtils {
+namespace Output {
+
+//------------------------------------------------------------------------------
+// Constructors
+
+CheckpointSink::CheckpointSink(const std::string &directory,
+                               std::uint64_t fingerprint,
+                               std::size_t toys_per_segment,
+                               std::chrono::duration<double> max_interval)
+    : m_directory(directory), m_fingerprint(fingerprint),
+      m_toys_per_segment(toys_per_segment > 0 ? toys_per_segment : 1),
+      m_max_interval(max_interval), m_last_write(Clock::now()) {
+  // Create the directory if needed, an existing one is fine
+  if ((mkdir(m_directory.c_str(), 0755) != 0) && (errno != EEXIST)) {
+    throw std::invalid_argument("Error(" + std::to_string(errno) +
+                                ") creating " + m_directory);
+  }
+
+  std::random_device random_device{};
+  std::ostringstream run_id{};
+  run_id << std::hex << random_device();
+  m_run_id = run_id.str();
+}
+
+//------------------------------------------------------------------------------
+
+void CheckpointSink::consume(const ToyInfo &info,
+                             PrEW::Fit::FitResult result) {
+  /** Buffer the result, write a segment once enough results are buffered or
+      the last segment is old enough.
+   **/
+  m_buffer.emplace_back(info, std::move(result));
+  if ((m_buffer.size() >= m_toys_per_segment) ||
+      (Clock::now() - m_last_write >= m_max_interval)) {
+    this->write_segment();
+  }
+}
+
+void CheckpointSink::finish() { this->write_segment(); }
+
+void CheckpointSink::poll() {
+  /** Write the buffered results if the last segment is old enough, also when
+      no new results arrive (e.g. during slow toys).
+   **/
+  if (!m_buffer.empty() && (Clock::now() - m_last_write >= m_max_interval)) {
+    this->write_segment();
+  }
+}
+
+void CheckpointSink::abort() {
+  /** Keep the finished toys of a failed run, a restart resumes from them.
+   **/
+  this->write_segment();
+}
+
+//------------------------------------------------------------------------------
+
+CheckpointSink::Data CheckpointSink::load(const std::string &directory,
+                                          std::uint64_t fingerprint) {
+  /** Read the results of all complete segments of the given setup.
+      A missing directory means there is nothing to resume from.
+      Unreadable segments are skipped with a warning.
+   **/
+  Data data{};
+  struct stat dir_stat {};
+  if (stat(directory.c_str(), &dir_stat) != 0) {
+    return data;
+  }
+
+  auto segments = SetupHelp::InputHelp::regex_search(
+      directory, segment_prefix(fingerprint) + "_.*\\.bin");
+  for (const auto &segment : segments) {
+    try {
+      std::uint64_t file_fingerprint{};
+      auto results = ResultIO::read_file(segment, &file_fingerprint);
+      if (file_fingerprint != fingerprint) {
+        spdlog::warn("CheckpointSink: Ignoring {} from different setup.",
+                     segment);
+        continue;
+      }
+      for (auto &info_result : results) {
+        data[info_result.first.m_energy].emplace(
+            info_result.first.m_toy_index, std::move(info_result.second));
+      }
+    } catch (const std::exception &error) {
+      spdlog::warn("CheckpointSink: Skipping {}: {}", segment, error.what());
+    }
+  }
+  return data;
+}
+
+//------------------------------------------------------------------------------
+
+void CheckpointSink::write_segment() {
+  /** Write all buffered results into a new segment.
+      The segment only appears under its final name once it is complete.
+   **/
+  m_last_write = Clock::now();
+  if (m_buffer.empty()) {
+    return;
+  }
+
+  std::string path = m_directory + "/" + segment_prefix(m_fingerprint) + "_" +
+                     m_run_id + "_" + std::to_string(m_n_segments++) + ".bin";
+  ResultIO::write_file(path, m_fingerprint, m_buffer);
+
+  spdlog::debug("CheckpointSink: Wrote {} results to {}.", m_buffer.size(),
+                path);
+  m_buffer.clear();
+}
+
+//------------------------------------------------------------------------------
+
+std::string CheckpointSink::segment_prefix(std::uint64_t fingerprint) {
+  std::ostringstream prefix{};
+  prefix << "toys_" << std::hex << fingerprint;
+  return prefix.str();
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Output
+} // namespace PrEWUtils
@@ -0,0 +1,198 @@
+#include <Output/ColumnarFile.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Memory mapping
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace PrEWUtils {
+namespace Output {
+
+//------------------------------------------------------------------------------
+// Constructors
+
+ColumnarFile::ColumnarFile(const std::string &path) : m_path(path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("ColumnarFile: Can't open " + path);
+  }
+  struct stat file_stat {};
+  if (::fstat(fd, &file_stat) != 0) {
+    ::close(fd);
+    throw std::runtime_error("ColumnarFile: Can't stat " + path);
+  }
+  m_map_size = static_cast<std::size_t>(file_stat.st_size);
+  if (m_map_size < sizeof(ColumnarFormat::FixedHeader)) {
+    ::close(fd);
+    throw std::runtime_error("ColumnarFile: Not a columnar result file " +
+                             path);
+  }
+
+  void *map = ::mmap(nullptr, m_map_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // The mapping stays valid
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("ColumnarFile: Can't map " + path);
+  }
+  m_map = static_cast<const char *>(map);
+  // Columns are read sequentially block by block
+  ::madvise(map, m_map_size, MADV_SEQUENTIAL);
+
+  try {
+    this->read_header();
+  } catch (...) {
+    ::munmap(map, m_map_size);
+    throw;
+  }
+}
+
+ColumnarFile::~ColumnarFile() {
+  ::munmap(const_cast<char *>(m_map), m_map_size);
+}
+
+//------------------------------------------------------------------------------
+// Access functions
+
+std::uint64_t ColumnarFile::get_fingerprint() const {
+  return m_header.m_fingerprint;
+}
+std::size_t ColumnarFile::get_n_results() const {
+  return static_cast<std::size_t>(m_header.m_n_results);
+}
+std::size_t ColumnarFile::get_block_size() const {
+  return m_layout.get_block_size();
+}
+const std::vector<std::string> &ColumnarFile::get_par_names() const {
+  return m_par_names;
+}
+const std::vector<double> &ColumnarFile::get_ref_vals() const {
+  return m_ref_vals;
+}
+bool ColumnarFile::has_covariance() const {
+  return m_layout.get_n_cov() > 0;
+}
+
+std::size_t ColumnarFile::get_par_index(const std::string &par_name) const {
+  auto name_it = std::find(m_par_names.begin(), m_par_names.end(), par_name);
+  if (name_it == m_par_names.end()) {
+    throw std::invalid_argument("ColumnarFile: Unknown parameter " +
+                                par_name);
+  }
+  return static_cast<std::size_t>(name_it - m_par_names.begin());
+}
+
+//------------------------------------------------------------------------------
+// Columns
+
+Column<std::int32_t> ColumnarFile::energies() const {
+  return this->column<std::int32_t>(m_layout.energy());
+}
+Column<std::int32_t> ColumnarFile::toy_indices() const {
+  return this->column<std::int32_t>(m_layout.toy_index());
+}
+Column<std::int32_t> ColumnarFile::statuses() const {
+  return this->column<std::int32_t>(m_layout.status());
+}
+Column<std::int32_t> ColumnarFile::n_calls() const {
+  return this->column<std::int32_t>(m_layout.n_calls());
+}
+Column<double> ColumnarFile::fcns() const {
+  return this->column<double>(m_layout.fcn());
+}
+Column<double> ColumnarFile::edms() const {
+  return this->column<double>(m_layout.edm());
+}
+
+Column<double> ColumnarFile::par_vals(std::size_t par) const {
+  this->check_par(par);
+  return this->column<double>(m_layout.par_val(par));
+}
+Column<double> ColumnarFile::par_uncs(std::size_t par) const {
+  this->check_par(par);
+  return this->column<double>(m_layout.par_unc(par));
+}
+
+Column<double> ColumnarFile::covariances(std::size_t par_1,
+                                         std::size_t par_2) const {
+  this->check_par(par_1);
+  this->check_par(par_2);
+  if (!this->has_covariance()) {
+    throw std::runtime_error("ColumnarFile: No covariances stored in " +
+                             m_path);
+  }
+  return this->column<double>(m_layout.cov(par_1, par_2));
+}
+
+//------------------------------------------------------------------------------
+// Internal functions
+
+void ColumnarFile::read_header() {
+  /** Read and check the header, including that the file holds all blocks.
+   **/
+  std::memcpy(&m_header, m_map, sizeof(m_header));
+  const auto &magic = ColumnarFormat::file_magic;
+  if (!std::equal(magic, magic + sizeof(magic), m_header.m_magic)) {
+    throw std::runtime_error("ColumnarFile: Not a columnar result file " +
+                             m_path);
+  }
+  if (m_header.m_version != ColumnarFormat::file_version) {
+    throw std::runtime_error("ColumnarFile: Unknown file version " +
+                             std::to_string(m_header.m_version));
+  }
+  if ((m_header.m_block_size == 0) || (m_header.m_block_size % 8 != 0)) {
+    throw std::runtime_error("ColumnarFile: Invalid block size in " + m_path);
+  }
+  m_layout = ColumnarFormat::Layout(
+      m_header.m_block_size, m_header.m_n_pars,
+      (m_header.m_flags & ColumnarFormat::HasCovariance) != 0);
+
+  std::size_t pos = sizeof(m_header);
+  auto check_size = [this](std::size_t end) {
+    if (end > m_map_size) {
+      throw std::runtime_error("ColumnarFile: File is truncated " + m_path);
+    }
+  };
+  for (std::uint32_t p = 0; p < m_header.m_n_pars; p++) {
+    std::uint32_t length{};
+    check_size(pos + sizeof(length));
+    std::memcpy(&length, m_map + pos, sizeof(length));
+    pos += sizeof(length);
+    check_size(pos + length);
+    m_par_names.emplace_back(m_map + pos, length);
+    pos += length;
+  }
+  pos = (pos + 7) / 8 * 8;
+  check_size(pos + m_header.m_n_pars * sizeof(double));
+  m_ref_vals.resize(m_header.m_n_pars);
+  std::memcpy(m_ref_vals.data(), m_map + pos,
+              m_header.m_n_pars * sizeof(double));
+  pos += m_header.m_n_pars * sizeof(double);
+
+  auto alignment = ColumnarFormat::header_alignment;
+  m_data_offset = (pos + alignment - 1) / alignment * alignment;
+  auto n_blocks = (m_header.m_n_results + m_header.m_block_size - 1) /
+                  m_header.m_block_size;
+  check_size(m_data_offset + n_blocks * m_layout.get_block_bytes());
+}
+
+template <class T>
+Column<T> ColumnarFile::column(std::size_t offset) const {
+  return Column<T>(m_map + m_data_offset, offset, m_layout.get_block_bytes(),
+                   m_layout.get_block_size(), this->get_n_results());
+}
+
+void ColumnarFile::check_par(std::size_t par) const {
+  if (par >= m_par_names.size()) {
+    throw std::out_of_range("ColumnarFile: Parameter index out of range " +
+                            std::to_string(par));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Output
+} // namespace PrEWUtils
@@ -0,0 +1,200 @@
+#include <Output/ColumnarSink.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Output {
+
+//------------------------------------------------------------------------------
+// Constructors
+
+ColumnarSink::ColumnarSink(const std::string &path, std::uint64_t fingerprint,
+                           const PrEW::Fit::ParVec &pars,
+                           std::size_t block_size, bool store_covariance)
+    : m_path(path),
+      m_layout(fit_block_size(block_size, pars.size(), store_covariance),
+               pars.size(), store_covariance),
+      m_file(path + ".tmp", std::ios::binary | std::ios::trunc) {
+  if (!m_file) {
+    throw std::invalid_argument("ColumnarSink: Can't open " + m_path +
+                                ".tmp");
+  }
+  std::copy(ColumnarFormat::file_magic,
+            ColumnarFormat::file_magic + sizeof(ColumnarFormat::file_magic),
+            m_header.m_magic);
+  m_header.m_version = ColumnarFormat::file_version;
+  m_header.m_n_pars = static_cast<std::uint32_t>(pars.size());
+  m_header.m_fingerprint = fingerprint;
+  m_header.m_block_size =
+      static_cast<std::uint32_t>(m_layout.get_block_size());
+  m_header.m_flags =
+      store_covariance ? std::uint32_t{ColumnarFormat::HasCovariance} : 0;
+
+  for (const auto &par : pars) {
+    m_par_names.push_back(par.get_name());
+  }
+  m_block.resize(m_layout.get_block_bytes());
+  // Number of results is rewritten when finishing
+  this->write_header(pars);
+}
+
+//------------------------------------------------------------------------------
+
+void ColumnarSink::consume(const ToyInfo &info, PrEW::Fit::FitResult result) {
+  /** Put the result into the current block, write the block once it's full.
+   **/
+  auto n_pars = m_par_names.size();
+  bool has_uncs = !result.m_uncs_fin.empty(); // Not kept by all fidelities
+  if ((result.m_pars_fin.size() != n_pars) ||
+      (has_uncs && (result.m_uncs_fin.size() != n_pars)) ||
+      (!result.m_par_names.empty() && (result.m_par_names != m_par_names))) {
+    throw std::invalid_argument("ColumnarSink: Result parameters don't match "
+                                "the parameters of the file!");
+  }
+
+  auto t = m_n_in_block;
+  this->set<std::int32_t>(m_layout.energy() + t * 4, info.m_energy);
+  this->set<std::int32_t>(m_layout.toy_index() + t * 4, info.m_toy_index);
+  this->set<std::int32_t>(m_layout.status() + t * 4, result.m_status);
+  this->set<std::int32_t>(m_layout.n_calls() + t * 4, result.m_n_calls);
+  this->set<double>(m_layout.fcn() + t * 8, result.m_chisq_fin);
+  this->set<double>(m_layout.edm() + t * 8, result.m_edm);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  for (std::size_t p = 0; p < n_pars; p++) {
+    this->set<double>(m_layout.par_val(p) + t * 8, result.m_pars_fin[p]);
+    this->set<double>(m_layout.par_unc(p) + t * 8,
+                      has_uncs ? result.m_uncs_fin[p] : nan);
+  }
+
+  if (m_layout.get_n_cov() > 0) {
+    // Covariance from the correlations, NaN if they weren't extracted
+    const auto &cor = result.m_cor_matrix;
+    bool has_cor = has_uncs && (cor.size() == n_pars);
+    for (std::size_t p = 0; p < n_pars; p++) {
+      has_cor = has_cor && (cor[p].size() == n_pars);
+    }
+    for (std::size_t p = 0; p < n_pars; p++) {
+      for (std::size_t q = p; q < n_pars; q++) {
+        double cov =
+            has_cor ? cor[p][q] * result.m_uncs_fin[p] * result.m_uncs_fin[q]
+                    : nan;
+        this->set<double>(m_layout.cov(p, q) + t * 8, cov);
+      }
+    }
+  }
+
+  m_header.m_n_results++;
+  if (++m_n_in_block == m_layout.get_block_size()) {
+    this->write_block();
+  }
+}
+
+void ColumnarSink::finish() {
+  /** Write the last (partial) block, complete the header and move the file to
+      its final path.
+   **/
+  if (m_finished) {
+    return;
+  }
+  m_finished = true;
+
+  if (m_n_in_block > 0) {
+    this->write_block();
+  }
+  m_file.seekp(0);
+  m_file.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header));
+  m_file.close();
+  if (!m_file) {
+    throw std::runtime_error("ColumnarSink: Failed writing " + m_path +
+                             ".tmp");
+  }
+  if (std::rename((m_path + ".tmp").c_str(), m_path.c_str()) != 0) {
+    throw std::runtime_error("ColumnarSink: Failed renaming " + m_path +
+                             ".tmp");
+  }
+  spdlog::info("ColumnarSink: Wrote {} results to {}.", m_header.m_n_results,
+               m_path);
+}
+
+void ColumnarSink::abort() {
+  /** Drop the incomplete temporary file, the path is left untouched.
+   **/
+  if (m_finished) {
+    return;
+  }
+  m_finished = true;
+
+  m_file.close();
+  std::remove((m_path + ".tmp").c_str());
+  spdlog::warn("ColumnarSink: Run aborted, dropped {} results for {}.",
+               m_header.m_n_results, m_path);
+}
+
+//------------------------------------------------------------------------------
+// Internal functions
+
+std::size_t ColumnarSink::fit_block_size(std::size_t block_size,
+                                         std::size_t n_pars,
+                                         bool store_covariance) {
+  /** Block size rounded up to a multiple of 8 toys (keeps all columns 8-byte
+      aligned), reduced in steps of 8 toys to stay within max_block_bytes.
+   **/
+  block_size = (std::max<std::size_t>(block_size, 1) + 7) / 8 * 8;
+  auto toy_bytes =
+      ColumnarFormat::Layout(1, n_pars, store_covariance).get_block_bytes();
+  auto max_toys = std::max<std::size_t>(max_block_bytes / toy_bytes / 8, 1) * 8;
+  return std::min(block_size, max_toys);
+}
+
+template <class T> void ColumnarSink::set(std::size_t offset, T value) {
+  std::memcpy(m_block.data() + offset, &value, sizeof(T));
+}
+
+void ColumnarSink::write_header(const PrEW::Fit::ParVec &pars) {
+  /** Write the full header, padded to the start of the first block.
+   **/
+  std::vector<char> header(sizeof(m_header));
+  std::memcpy(header.data(), &m_header, sizeof(m_header));
+  auto append = [&header](const void *data, std::size_t size) {
+    const auto *bytes = static_cast<const char *>(data);
+    header.insert(header.end(), bytes, bytes + size);
+  };
+
+  for (const auto &name : m_par_names) {
+    auto length = static_cast<std::uint32_t>(name.size());
+    append(&length, sizeof(length));
+    append(name.data(), name.size());
+  }
+  header.resize((header.size() + 7) / 8 * 8, '\0');
+  for (const auto &par : pars) {
+    double ref_val = par.get_val_ini();
+    append(&ref_val, sizeof(ref_val));
+  }
+  auto alignment = ColumnarFormat::header_alignment;
+  header.resize((header.size() + alignment - 1) / alignment * alignment, '\0');
+
+  m_file.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+void ColumnarSink::write_block() {
+  /** Write the current block in full and start a new one.
+   **/
+  m_file.write(m_block.data(), static_cast<std::streamsize>(m_block.size()));
+  if (!m_file) {
+    throw std::runtime_error("ColumnarSink: Failed writing " + m_path +
+                             ".tmp");
+  }
+  std::fill(m_block.begin(), m_block.end(), '\0');
+  m_n_in_block = 0;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Output
+} // namespace PrEWUtils
@@ -0,0 +1,74 @@
+#include <Output/ResultFileSink.h>
+#include <Output/ResultIO.h>
+
+#include "spdlog/spdlog.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Output {
+
+//------------------------------------------------------------------------------
+// Constructors
+
+ResultFileSink::ResultFileSink(const std::string &path,
+                               std::uint64_t fingerprint)
+    : m_path(path), m_fingerprint(fingerprint),
+      m_file(path + ".tmp", std::ios::binary | std::ios::trunc) {
+  if (!m_file) {
+    throw std::invalid_argument("ResultFileSink: Can't open " + m_path +
+                                ".tmp");
+  }
+  // Header is rewritten with the final number of results when finishing
+  ResultIO::write_file_header(m_file, m_fingerprint, 0);
+}
+
+//------------------------------------------------------------------------------
+
+void ResultFileSink::consume(const ToyInfo &info,
+                             PrEW::Fit::FitResult result) {
+  ResultIO::write_result(m_file, info, result);
+  m_n_results++;
+}
+
+void ResultFileSink::finish() {
+  /** Complete the header and move the file to its final path.
+   **/
+  if (m_finished) {
+    return;
+  }
+  m_finished = true;
+
+  m_file.seekp(0);
+  ResultIO::write_file_header(m_file, m_fingerprint, m_n_results);
+  m_file.close();
+  if (!m_file) {
+    throw std::runtime_error("ResultFileSink: Failed writing " + m_path +
+                             ".tmp");
+  }
+  if (std::rename((m_path + ".tmp").c_str(), m_path.c_str()) != 0) {
+    throw std::runtime_error("ResultFileSink: Failed renaming " + m_path +
+                             ".tmp");
+  }
+  spdlog::info("ResultFileSink: Wrote {} results to {}.", m_n_results, m_path);
+}
+
+void ResultFileSink::abort() {
+  /** Drop the incomplete temporary file, the path is left untouched.
+   **/
+  if (m_finished) {
+    return;
+  }
+  m_finished = true;
+
+  m_file.close();
+  std::remove((m_path + ".tmp").c_str());
+  spdlog::warn("ResultFileSink: Run aborted, dropped {} results for {}.",
+               m_n_results, m_path);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Output
+} // namespace PrEWUtils
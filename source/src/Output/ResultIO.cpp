@@ -0,0 +1,259 @@
+#include <Output/ResultIO.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace PrEWUtils {
+namespace Output {
+namespace ResultIO {
+
+namespace {
+
+const char file_magic[8] = {'P', 'R', 'U', 'T', 'O', 'Y', 'S', '\0'};
+const std::uint32_t file_version = 1;
+
+// Bytes of a result without any parameters
+const std::uint64_t min_result_size = 3 * sizeof(std::int32_t) +
+                                      5 * sizeof(std::uint64_t) +
+                                      2 * sizeof(double) +
+                                      2 * sizeof(std::int32_t);
+
+//------------------------------------------------------------------------------
+// Primitive writers and readers
+
+template <class T> void write_value(std::ostream &out, T value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <class T> T read_value(std::istream &in) {
+  T value{};
+  in.read(reinterpret_cast<char *>(&value), sizeof(T));
+  if (!in) {
+    throw std::runtime_error("ResultIO: Unexpected end of input.");
+  }
+  return value;
+}
+
+void write_doubles(std::ostream &out, const std::vector<double> &values) {
+  write_value<std::uint64_t>(out, values.size());
+  out.write(reinterpret_cast<const char *>(values.data()),
+            static_cast<std::streamsize>(values.size() * sizeof(double)));
+}
+
+std::uint64_t remaining_bytes(std::istream &in) {
+  /** Number of bytes left in the input, maximum if it can't be determined
+      (e.g. not seekable).
+   **/
+  auto pos = in.tellg();
+  if (pos < 0) {
+    return std::numeric_limits<std::uint64_t>::max();
+  }
+  in.seekg(0, std::ios::end);
+  auto end = in.tellg();
+  in.seekg(pos);
+  if ((end < 0) || !in) {
+    in.clear();
+    in.seekg(pos);
+    return std::numeric_limits<std::uint64_t>::max();
+  }
+  return static_cast<std::uint64_t>(end - pos);
+}
+
+template <class T>
+std::uint64_t read_count(std::istream &in, std::uint64_t min_element_size) {
+  /** Read a number of elements and check that the input can hold that many,
+      so that corrupt counts never cause huge allocations.
+   **/
+  std::uint64_t count = read_value<T>(in);
+  if (count > remaining_bytes(in) / min_element_size) {
+    throw std::runtime_error("ResultIO: Count " + std::to_string(count) +
+                             " exceeds the input size.");
+  }
+  return count;
+}
+
+std::vector<double> read_doubles(std::istream &in) {
+  auto n_values = read_count<std::uint64_t>(in, sizeof(double));
+  // Grow in chunks, the input size is unknown for non-seekable streams
+  const std::uint64_t chunk_size = 1 << 16;
+  std::vector<double> values{};
+  while (values.size() < n_values) {
+    auto n_read = std::min<std::uint64_t>(chunk_size, n_values - values.size());
+    auto offset = values.size();
+    values.resize(offset + n_read);
+    in.read(reinterpret_cast<char *>(values.data() + offset),
+            static_cast<std::streamsize>(n_read * sizeof(double)));
+    if (!in) {
+      throw std::runtime_error("ResultIO: Unexpected end of input.");
+    }
+  }
+  return values;
+}
+
+void write_string(std::ostream &out, const std::string &str) {
+  write_value<std::uint32_t>(out, static_cast<std::uint32_t>(str.size()));
+  out.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+std::string read_string(std::istream &in) {
+  std::string str(read_count<std::uint32_t>(in, 1), '\0');
+  in.read(&str[0], static_cast<std::streamsize>(str.size()));
+  if (!in) {
+    throw std::runtime_error("ResultIO: Unexpected end of input.");
+  }
+  return str;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void write_file_header(std::ostream &out, std::uint64_t fingerprint,
+                       std::uint64_t n_results) {
+  out.write(file_magic, sizeof(file_magic));
+  write_value<std::uint32_t>(out, file_version);
+  write_value<std::uint64_t>(out, fingerprint);
+  write_value<std::uint64_t>(out, n_results);
+}
+
+void read_file_header(std::istream &in, std::uint64_t *fingerprint,
+                      std::uint64_t *n_results) {
+  /** Read and check the file header.
+      Throws if the input is not a result file of a known version.
+   **/
+  char magic[sizeof(file_magic)]{};
+  in.read(magic, sizeof(magic));
+  if (!in || !std::equal(magic, magic + sizeof(magic), file_magic)) {
+    throw std::runtime_error("ResultIO: Input is not a toy result file.");
+  }
+  auto version = read_value<std::uint32_t>(in);
+  if (version != file_version) {
+    throw std::runtime_error("ResultIO: Unknown file version " +
+                             std::to_string(version));
+  }
+  *fingerprint = read_value<std::uint64_t>(in);
+  *n_results = read_value<std::uint64_t>(in);
+}
+
+//------------------------------------------------------------------------------
+
+void write_result(std::ostream &out, const ToyInfo &info,
+                  const PrEW::Fit::FitResult &result) {
+  /** Append a single toy result to the stream.
+   **/
+  write_value<std::int32_t>(out, info.m_energy);
+  write_value<std::int32_t>(out, info.m_toy_index);
+
+  write_value<std::uint32_t>(
+      out, static_cast<std::uint32_t>(result.m_par_names.size()));
+  for (const auto &name : result.m_par_names) {
+    write_string(out, name);
+  }
+  write_doubles(out, result.m_pars_ini);
+  write_doubles(out, result.m_pars_fin);
+  write_doubles(out, result.m_uncs_ini);
+  write_doubles(out, result.m_uncs_fin);
+
+  write_value<std::uint64_t>(out, result.m_cor_matrix.size());
+  for (const auto &row : result.m_cor_matrix) {
+    write_doubles(out, row);
+  }
+
+  write_value<double>(out, result.m_chisq_fin);
+  write_value<double>(out, result.m_edm);
+  write_value<std::int32_t>(out, result.m_n_calls);
+  write_value<std::int32_t>(out, result.m_status);
+}
+
+//------------------------------------------------------------------------------
+
+void read_result(std::istream &in, ToyInfo *info,
+                 PrEW::Fit::FitResult *result) {
+  /** Read the next toy result from the stream.
+      Throws if the stream ends within the result.
+   **/
+  info->m_energy = read_value<std::int32_t>(in);
+  info->m_toy_index = read_value<std::int32_t>(in);
+
+  // Every name has at least its length
+  result->m_par_names.resize(
+      read_count<std::uint32_t>(in, sizeof(std::uint32_t)));
+  for (auto &name : result->m_par_names) {
+    name = read_string(in);
+  }
+  result->m_pars_ini = read_doubles(in);
+  result->m_pars_fin = read_doubles(in);
+  result->m_uncs_ini = read_doubles(in);
+  result->m_uncs_fin = read_doubles(in);
+
+  // Every row has at least its length
+  result->m_cor_matrix.resize(
+      read_count<std::uint64_t>(in, sizeof(std::uint64_t)));
+  for (auto &row : result->m_cor_matrix) {
+    row = read_doubles(in);
+  }
+
+  result->m_chisq_fin = read_value<double>(in);
+  result->m_edm = read_value<double>(in);
+  result->m_n_calls = read_value<std::int32_t>(in);
+  result->m_status = read_value<std::int32_t>(in);
+}
+
+//------------------------------------------------------------------------------
+
+void write_file(const std::string &path, std::uint64_t fingerprint,
+                const InfoResultVec &results) {
+  /** Write the results into a temporary file and rename it once complete, so
+      the file at the given path is either absent or complete.
+   **/
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    write_file_header(file, fingerprint, results.size());
+    for (const auto &info_result : results) {
+      write_result(file, info_result.first, info_result.second);
+    }
+    file.close();
+    if (!file) {
+      throw std::runtime_error("ResultIO: Failed writing " + tmp_path);
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    throw std::runtime_error("ResultIO: Failed renaming " + tmp_path);
+  }
+}
+
+InfoResultVec read_file(const std::string &path, std::uint64_t *fingerprint) {
+  /** Read all results of a result file.
+      Throws if the file can't be read completely.
+   **/
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("ResultIO: Can't open " + path);
+  }
+  std::uint64_t n_results{};
+  read_file_header(file, fingerprint, &n_results);
+  if (n_results > remaining_bytes(file) / min_result_size) {
+    throw std::runtime_error("ResultIO: File is truncated " + path);
+  }
+
+  InfoResultVec results(n_results);
+  for (auto &info_result : results) {
+    read_result(file, &info_result.first, &info_result.second);
+  }
+  return results;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace ResultIO
+} // namespace Output
+} // namespace PrEWUtils
@@ -0,0 +1,21 @@
+#include <Output/ResultSink.h>
+
+namespace PrEWUtils {
+namespace Output {
+
+//------------------------------------------------------------------------------
+// Constructors
+
+CallbackSink::CallbackSink(Callback callback)
+    : m_callback(std::move(callback)) {}
+
+//------------------------------------------------------------------------------
+
+void CallbackSink::consume(const ToyInfo &info, PrEW::Fit::FitResult result) {
+  m_callback(info, result);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Output
+} // namespace PrEWUtils
@@ -0,0 +1,87 @@
+#include <Output/ShardMerge.h>
+
+#include "spdlog/spdlog.h"
+
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Output {
+namespace ShardMerge {
+
+//------------------------------------------------------------------------------
+
+bool MergeReport::is_complete() const {
+  return m_duplicates.empty() && m_gaps.empty();
+}
+
+//------------------------------------------------------------------------------
+
+ResultIO::ResultMap merge_files(const std::vector<std::string> &files,
+                                int n_toys, MergeReport *report) {
+  /** Combine the results of all given files into a single result set.
+      All files must stem from the same setup (same fingerprint).
+      Toys found more than once are kept only once and reported as
+      duplicates, toy indices in [0, n_toys) that are missing are reported as
+      gaps (if n_toys <= 0 up to the largest index found per energy).
+   **/
+  *report = MergeReport{};
+  ResultIO::ResultMap merged{};
+
+  for (std::size_t f = 0; f < files.size(); f++) {
+    std::uint64_t fingerprint{};
+    auto results = ResultIO::read_file(files[f], &fingerprint);
+    if (f == 0) {
+      report->m_fingerprint = fingerprint;
+    } else if (fingerprint != report->m_fingerprint) {
+      throw std::invalid_argument("ShardMerge: " + files[f] +
+                                  " belongs to a different setup than " +
+                                  files[0]);
+    }
+    spdlog::debug("ShardMerge: {} results in {}.", results.size(), files[f]);
+
+    for (auto &info_result : results) {
+      const auto &info = info_result.first;
+      auto &energy_results = merged[info.m_energy];
+      if (!energy_results
+               .emplace(info.m_toy_index, std::move(info_result.second))
+               .second) {
+        report->m_duplicates[info.m_energy].push_back(info.m_toy_index);
+      }
+    }
+  }
+
+  for (const auto &energy_results : merged) {
+    int n_expected = n_toys;
+    if ((n_expected <= 0) && !energy_results.second.empty()) {
+      n_expected = energy_results.second.rbegin()->first + 1;
+    }
+    for (int t = 0; t < n_expected; t++) {
+      if (energy_results.second.count(t) == 0) {
+        report->m_gaps[energy_results.first].push_back(t);
+      }
+    }
+    report->m_n_results += energy_results.second.size();
+  }
+  return merged;
+}
+
+//------------------------------------------------------------------------------
+
+ResultIO::InfoResultVec flatten(const ResultIO::ResultMap &results) {
+  /** Results ordered by energy and toy index, as written to result files.
+   **/
+  ResultIO::InfoResultVec flat{};
+  for (const auto &energy_results : results) {
+    for (const auto &index_result : energy_results.second) {
+      flat.push_back(
+          {{energy_results.first, index_result.first}, index_result.second});
+    }
+  }
+  return flat;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace ShardMerge
+} // namespace Output
+} // namespace PrEWUtils
@@ -0,0 +1,144 @@
+#include <Parallel/CpuTopology.h>
+
+#include "spdlog/spdlog.h"
+
+// Standard library
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+// System headers for affinity
+#include <pthread.h>
+#include <sched.h>
+
+namespace PrEWUtils {
+namespace Parallel {
+namespace CpuTopology {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+std::vector<int> read_cpu_list(const std::string &path) {
+  /** Read a sysfs CPU list of form "0-3,8,10-11".
+   **/
+  std::vector<int> cpus{};
+  std::ifstream file(path);
+  std::string range{};
+  while (std::getline(file, range, ',')) {
+    auto dash = range.find('-');
+    try {
+      int first = std::stoi(range.substr(0, dash));
+      int last = (dash == std::string::npos)
+                     ? first
+                     : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception &) {
+      // Empty or malformed entry, e.g. trailing newline
+    }
+  }
+  return cpus;
+}
+
+const std::map<int, int> &cpu_nodes() {
+  /** NUMA node of every CPU listed in sysfs, read once.
+   **/
+  static const std::map<int, int> nodes = [] {
+    std::map<int, int> nodes{};
+    auto node_ids = read_cpu_list("/sys/devices/system/node/online");
+    for (const auto &node : node_ids) {
+      for (const auto &cpu : read_cpu_list("/sys/devices/system/node/node" +
+                                           std::to_string(node) +
+                                           "/cpulist")) {
+        nodes[cpu] = node;
+      }
+    }
+    return nodes;
+  }();
+  return nodes;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+std::vector<Cpu> available_cpus() {
+  std::vector<Cpu> cpus{};
+  cpu_set_t cpu_set{};
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &cpu_set)) {
+        cpus.push_back({cpu, node_of_cpu(cpu)});
+      }
+    }
+  }
+  std::sort(cpus.begin(), cpus.end(), [](const Cpu &a, const Cpu &b) {
+    return (a.m_node < b.m_node) ||
+           ((a.m_node == b.m_node) && (a.m_id < b.m_id));
+  });
+  return cpus;
+}
+
+int n_nodes() {
+  int n_nodes = 1;
+  for (const auto &cpu_node : cpu_nodes()) {
+    n_nodes = std::max(n_nodes, cpu_node.second + 1);
+  }
+  return n_nodes;
+}
+
+int node_of_cpu(int cpu) {
+  auto node_it = cpu_nodes().find(cpu);
+  return (node_it == cpu_nodes().end()) ? 0 : node_it->second;
+}
+
+int current_node() {
+  int cpu = sched_getcpu();
+  return (cpu < 0) ? 0 : node_of_cpu(cpu);
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<int> spread_cpus(std::size_t n_workers) {
+  /** Pick a CPU for each worker.
+      Consecutive workers get neighbouring CPUs and the workers are spread
+      evenly over the available CPUs, so that each node gets its share of
+      workers. With more workers than CPUs the CPUs are reused in turn.
+   **/
+  auto cpus = available_cpus();
+  std::vector<int> worker_cpus{};
+  if (cpus.empty()) {
+    return std::vector<int>(n_workers, -1);
+  }
+  for (std::size_t w = 0; w < n_workers; w++) {
+    std::size_t index = (n_workers <= cpus.size())
+                            ? w * cpus.size() / n_workers
+                            : w % cpus.size();
+    worker_cpus.push_back(cpus[index].m_id);
+  }
+  return worker_cpus;
+}
+
+bool pin_current_thread(int cpu) {
+  /** Restrict the calling thread to the given CPU.
+   **/
+  if (cpu < 0) {
+    return false;
+  }
+  cpu_set_t cpu_set{};
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace CpuTopology
+} // namespace Parallel
+} // namespace PrEWUtils
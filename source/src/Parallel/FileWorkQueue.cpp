@@ -0,0 +1,311 @@
+#include <Parallel/FileWorkQueue.h>
+
+#include "spdlog/spdlog.h"
+
+// Standard library
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+// System headers for atomic file operations
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+namespace PrEWUtils {
+namespace Parallel {
+
+//------------------------------------------------------------------------------
+// Constructors
+
+FileWorkQueue::FileWorkQueue(const std::string &directory,
+                             std::uint64_t fingerprint, int n_toys,
+                             int toys_per_batch,
+                             std::chrono::duration<double> claim_timeout)
+    : m_directory(directory), m_fingerprint(fingerprint), m_n_toys(n_toys),
+      m_toys_per_batch(toys_per_batch), m_claim_timeout(claim_timeout),
+      m_last_heartbeat(Clock::now()) {
+  /** Open the queue in the given directory, creating it if needed.
+      All processes working on the same queue must use the same fingerprint,
+      number of toys and batch size.
+   **/
+  if ((m_n_toys < 0) || (m_toys_per_batch < 1)) {
+    throw std::invalid_argument("FileWorkQueue: Invalid campaign of " +
+                                std::to_string(m_n_toys) +
+                                " toys in batches of " +
+                                std::to_string(m_toys_per_batch));
+  }
+  // Create the directory if needed, an existing one is fine
+  if ((mkdir(m_directory.c_str(), 0755) != 0) && (errno != EEXIST)) {
+    throw std::invalid_argument("Error(" + std::to_string(errno) +
+                                ") creating " + m_directory);
+  }
+
+  char host[256] = {};
+  gethostname(host, sizeof(host) - 1);
+  std::random_device random_device{};
+  std::ostringstream owner{};
+  owner << host << "_" << getpid() << "_" << std::hex << random_device();
+  m_owner = owner.str();
+
+  this->check_campaign();
+}
+
+//------------------------------------------------------------------------------
+
+bool FileWorkQueue::claim(Batch *batch) {
+  /** Claim the first batch that is neither done nor claimed by a live
+      process.
+      Returns false if there is no such batch right now.
+   **/
+  for (int b = 0; b < this->n_batches(); b++) {
+    if (!this->is_done(b) && this->try_claim(b)) {
+      *batch = this->get_batch(b);
+      m_claimed.push_back(b);
+      spdlog::info("FileWorkQueue: Claimed batch {} (toys {}-{}).", b,
+                   batch->m_first_toy, batch->m_last_toy - 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+void FileWorkQueue::heartbeat() {
+  /** Refresh the claims of this process so that other processes don't take
+      them for abandoned.
+      Only touches the filesystem a few times per claim timeout, so it can be
+      called as often as convenient.
+   **/
+  if (Clock::now() - m_last_heartbeat < m_claim_timeout / 4.0) {
+    return;
+  }
+  for (const auto &b : m_claimed) {
+    if (!this->owns_claim(b) ||
+        (utime(this->claim_path(b).c_str(), nullptr) != 0)) {
+      spdlog::warn("FileWorkQueue: Lost claim on batch {}, continuing anyway.",
+                   b);
+    }
+  }
+  m_last_heartbeat = Clock::now();
+}
+
+//------------------------------------------------------------------------------
+
+void FileWorkQueue::complete(const Batch &batch,
+                             const Output::ResultIO::InfoResultVec &results) {
+  /** Write the results of a claimed batch and release the claim.
+      The results are written to a file of this process and then published
+      under the batch result name (link fails if it exists), so a process
+      that fitted the batch a second time leaves the first results in place.
+      The result file is complete before the claim disappears, so a crash in
+      between can at most lead to the batch being redone.
+   **/
+  std::string result_path = this->result_path(batch.m_index);
+  std::string own_path = result_path + "." + m_owner;
+  Output::ResultIO::write_file(own_path, m_fingerprint, results);
+  if ((link(own_path.c_str(), result_path.c_str()) != 0) &&
+      (errno != EEXIST)) {
+    auto error = errno;
+    std::remove(own_path.c_str());
+    throw std::runtime_error("FileWorkQueue: Error(" + std::to_string(error) +
+                             ") publishing " + result_path);
+  }
+  std::remove(own_path.c_str());
+  this->drop_claim(batch.m_index);
+  spdlog::info("FileWorkQueue: Completed batch {} ({} of {} done).",
+               batch.m_index, this->n_done(), this->n_batches());
+}
+
+void FileWorkQueue::release(const Batch &batch) {
+  /** Give up a claimed batch without results, e.g. when the run is
+      cancelled, so that other processes can take it right away.
+   **/
+  this->drop_claim(batch.m_index);
+  spdlog::info("FileWorkQueue: Released batch {}.", batch.m_index);
+}
+
+//------------------------------------------------------------------------------
+// Access functions
+
+std::uint64_t FileWorkQueue::get_fingerprint() const { return m_fingerprint; }
+
+std::chrono::duration<double> FileWorkQueue::get_claim_timeout() const {
+  return m_claim_timeout;
+}
+
+int FileWorkQueue::n_batches() const {
+  return (m_n_toys + m_toys_per_batch - 1) / m_toys_per_batch;
+}
+
+int FileWorkQueue::n_done() const {
+  int n_done = 0;
+  for (int b = 0; b < this->n_batches(); b++) {
+    n_done += this->is_done(b);
+  }
+  return n_done;
+}
+
+bool FileWorkQueue::is_complete() const {
+  return this->n_done() == this->n_batches();
+}
+
+std::vector<std::string> FileWorkQueue::result_files() const {
+  /** Result files of all completed batches, e.g. for Output::ShardMerge.
+   **/
+  std::vector<std::string> files{};
+  for (int b = 0; b < this->n_batches(); b++) {
+    if (this->is_done(b)) {
+      files.push_back(this->result_path(b));
+    }
+  }
+  return files;
+}
+
+//------------------------------------------------------------------------------
+// Internal functions
+
+void FileWorkQueue::check_campaign() const {
+  /** Make sure the queue directory belongs to this campaign.
+      The first process atomically publishes the campaign description (link
+      fails if it exists), all others compare against it.
+   **/
+  std::ostringstream campaign{};
+  campaign << m_fingerprint << " " << m_n_toys << " " << m_toys_per_batch;
+
+  std::string info_path = m_directory + "/queue.info";
+  std::string tmp_path = info_path + "." + m_owner + ".tmp";
+  {
+    std::ofstream tmp_file(tmp_path);
+    tmp_file << campaign.str() << "\n";
+    tmp_file.close();
+    if (!tmp_file) {
+      throw std::runtime_error("FileWorkQueue: Failed writing " + tmp_path);
+    }
+  }
+  bool is_new = (link(tmp_path.c_str(), info_path.c_str()) == 0);
+  std::remove(tmp_path.c_str());
+
+  if (!is_new) {
+    std::ifstream info_file(info_path);
+    std::string existing{};
+    std::getline(info_file, existing);
+    if (existing != campaign.str()) {
+      throw std::invalid_argument(
+          "FileWorkQueue: " + m_directory + " holds a different campaign (" +
+          existing + " instead of " + campaign.str() + ")");
+    }
+  }
+  spdlog::info("FileWorkQueue: {} queue in {} with {} batches.",
+               is_new ? "New" : "Joined", m_directory, this->n_batches());
+}
+
+//------------------------------------------------------------------------------
+
+FileWorkQueue::Batch FileWorkQueue::get_batch(int index) const {
+  int first = index * m_toys_per_batch;
+  return {index, first, std::min(first + m_toys_per_batch, m_n_toys)};
+}
+
+//------------------------------------------------------------------------------
+
+bool FileWorkQueue::try_claim(int index) {
+  /** Try to claim the batch with the given index by exclusively creating its
+      claim file.
+      An existing claim that is older than the claim timeout is moved away
+      (only one process can succeed in that) and the claim is retried.
+   **/
+  std::string path = this->claim_path(index);
+  for (int attempt = 0; attempt < 2; attempt++) {
+    int fd = open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (fd >= 0) {
+      auto n_written = write(fd, m_owner.data(), m_owner.size());
+      close(fd);
+      if (n_written < 0) {
+        spdlog::warn("FileWorkQueue: Couldn't write owner of {}.", path);
+      }
+      // The batch may have been completed since it was last checked
+      if (this->is_done(index)) {
+        std::remove(path.c_str());
+        return false;
+      }
+      return true;
+    }
+    if (errno != EEXIST) {
+      throw std::runtime_error("FileWorkQueue: Error(" +
+                               std::to_string(errno) + ") creating " + path);
+    }
+
+    struct stat claim_stat {};
+    if (stat(path.c_str(), &claim_stat) != 0) {
+      continue; // Claim just released, try again
+    }
+    auto age = std::difftime(std::time(nullptr), claim_stat.st_mtime);
+    if (age <= m_claim_timeout.count()) {
+      return false;
+    }
+    std::string stale_path = path + ".stale." + m_owner;
+    if (std::rename(path.c_str(), stale_path.c_str()) != 0) {
+      return false; // Another process was faster
+    }
+    std::remove(stale_path.c_str());
+    spdlog::warn("FileWorkQueue: Reclaiming batch {} after {}s without "
+                 "heartbeat.",
+                 index, age);
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+bool FileWorkQueue::owns_claim(int index) const {
+  /** Whether the claim file of the batch still names this process, it
+      doesn't once the claim was reclaimed by another process.
+   **/
+  std::ifstream claim_file(this->claim_path(index));
+  std::string owner{};
+  std::getline(claim_file, owner);
+  return owner == m_owner;
+}
+
+void FileWorkQueue::drop_claim(int index) {
+  /** Forget the claim of the batch and remove its claim file, unless it has
+      been taken over by another process in the meantime.
+   **/
+  if (this->owns_claim(index)) {
+    std::remove(this->claim_path(index).c_str());
+  } else {
+    spdlog::warn("FileWorkQueue: Claim on batch {} was taken over, leaving "
+                 "it to its new owner.",
+                 index);
+  }
+  m_claimed.erase(std::remove(m_claimed.begin(), m_claimed.end(), index),
+                  m_claimed.end());
+}
+
+//------------------------------------------------------------------------------
+
+bool FileWorkQueue::is_done(int index) const {
+  struct stat result_stat {};
+  return stat(this->result_path(index).c_str(), &result_stat) == 0;
+}
+
+std::string FileWorkQueue::claim_path(int index) const {
+  return m_directory + "/batch_" + std::to_string(index) + ".claim";
+}
+
+std::string FileWorkQueue::result_path(int index) const {
+  return m_directory + "/batch_" + std::to_string(index) + ".bin";
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Parallel
+} // namespace PrEWUtils
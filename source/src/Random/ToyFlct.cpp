@@ -0,0 +1,58 @@
+#include <Random/ToyFlct.h>
+
+#include <random>
+
+namespace PrEWUtils {
+namespace Random {
+
+//------------------------------------------------------------------------------
+
+namespace {
+double poisson(double mean, Philox &rng) {
+  /** Single Poisson draw, empty or negative expectations give zero.
+   **/
+  if (mean <= 0) {
+    return 0.0;
+  }
+  std::poisson_distribution<long> distribution(mean);
+  return static_cast<double>(distribution(rng));
+}
+} // namespace
+
+//------------------------------------------------------------------------------
+
+Philox ToyFlct::toy_stream(std::uint64_t campaign_seed, int energy,
+                           int toy_index, Domain domain) {
+  /** Create the random stream of a given toy.
+   **/
+  return Philox(campaign_seed, static_cast<std::uint32_t>(toy_index),
+                static_cast<std::uint32_t>(energy),
+                static_cast<std::uint32_t>(domain));
+}
+
+//------------------------------------------------------------------------------
+
+void ToyFlct::fluctuate_bins(const std::vector<double> &expected,
+                             std::vector<double> *measured, Philox &rng) {
+  /** Poisson-fluctuate a flat vector of expected bin contents into the given
+      output vector, which is reused if it already has the right size.
+   **/
+  measured->resize(expected.size());
+  for (std::size_t b = 0; b < expected.size(); b++) {
+    (*measured)[b] = poisson(expected[b], rng);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+double ToyFlct::fluctuate_constr(double val, double unc, Philox &rng) {
+  /** Draw a new constraint centre from the Gaussian constraint (val, unc).
+   **/
+  std::normal_distribution<double> distribution(val, unc);
+  return distribution(rng);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Random
+} // namespace PrEWUtils
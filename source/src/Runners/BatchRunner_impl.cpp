@@ -0,0 +1,23 @@
+#include <Runners/BatchRunner.h>
+#include <Setups/GeneralSetup.h>
+
+namespace PrEWUtils {
+namespace Runners {
+  /** Instantiating BatchRunner with each possible setup.
+      Serves the sole purpose of compiling the header template in order to 
+      figure out if code is correct.
+      Note meant to be included or used anywhere.
+  **/
+  
+  template class BatchRunner<Setups::GeneralSetup>;
+  template class BatchRunner<
+    Setups::GeneralSetup, 
+    Policies::RunnerPolicy<Policies::ChiSquared, Policies::NoSelection>
+  >;
+  template class BatchRunner<
+    Setups::GeneralSetup, 
+    Policies::RunnerPolicy<Policies::PoissonNLL, Policies::NoSelection>
+  >;
+  
+} // Namespace Runners
+} // Namespace PrEWUtils
@@ -0,0 +1,23 @@
+#include <Runners/LikelihoodScan.h>
+#include <Setups/GeneralSetup.h>
+
+namespace PrEWUtils {
+namespace Runners {
+  /** Instantiating LikelihoodScan with each possible setup.
+      Serves the sole purpose of compiling the header template in order to 
+      figure out if code is correct.
+      Note meant to be included or used anywhere.
+  **/
+  
+  template class LikelihoodScan<Setups::GeneralSetup>;
+  template class LikelihoodScan<
+    Setups::GeneralSetup, 
+    Policies::RunnerPolicy<Policies::ChiSquared, Policies::NoSelection>
+  >;
+  template class LikelihoodScan<
+    Setups::GeneralSetup, 
+    Policies::RunnerPolicy<Policies::PoissonNLL, Policies::NoSelection>
+  >;
+  
+} // Namespace Runners
+} // Namespace PrEWUtils
@@ -10,6 +10,14 @@ namespace Runners {
   **/
   
   template class ParallelRunner<Setups::GeneralSetup>;
+  template class ParallelRunner<
+    Setups::GeneralSetup, 
+    Policies::RunnerPolicy<Policies::ChiSquared, Policies::NoSelection>
+  >;
+  template class ParallelRunner<
+    Setups::GeneralSetup, 
+    Policies::RunnerPolicy<Policies::PoissonNLL, Policies::NoSelection>
+  >;
   
 } // Namespace Runners
 } // Namespace PrEWUtils
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include <Runners/ResultFidelity.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace PrEWUtils {
+namespace Runners {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+template <class T>
+void keep_entries(std::vector<T> *values,
+                  const std::vector<std::size_t> &kept) {
+  /** Keep only the entries at the given (ascending) indices, values that are
+      missing or already trimmed stay empty.
+   **/
+  if (values->empty()) {
+    return;
+  }
+  std::vector<T> kept_values{};
+  kept_values.reserve(kept.size());
+  for (const auto &index : kept) {
+    kept_values.push_back(std::move(values->at(index)));
+  }
+  values->swap(kept_values);
+}
+
+template <class T> void release(std::vector<T> *values) {
+  std::vector<T>().swap(*values);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+bool ResultFidelity::is_full() const {
+  return (m_level == Full) && m_categories.empty();
+}
+
+bool ResultFidelity::keeps_uncertainties() const { return m_level != Values; }
+
+//------------------------------------------------------------------------------
+
+std::vector<std::size_t>
+ResultFidelity::kept_pars(const PrEW::Fit::ParVec &pars) const {
+  /** Indices of the parameters in the selected categories.
+      Like in ParOrder::categorize_pars each parameter belongs to the first
+      category (in ID map order) it fits, parameters fitting no category are
+      dropped.
+   **/
+  for (const auto &category : m_categories) {
+    if (!m_id_map.count(category)) {
+      throw std::invalid_argument("ResultFidelity: Unknown category " +
+                                  category);
+    }
+  }
+
+  std::vector<std::size_t> kept{};
+  for (std::size_t p = 0; p < pars.size(); p++) {
+    if (m_categories.empty()) {
+      kept.push_back(p);
+      continue;
+    }
+    for (const auto &category_ids : m_id_map) {
+      if (SetupHelp::ParOrder::par_fits_ID(pars[p], category_ids.second)) {
+        if (std::find(m_categories.begin(), m_categories.end(),
+                      category_ids.first) != m_categories.end()) {
+          kept.push_back(p);
+        }
+        break;
+      }
+    }
+  }
+  return kept;
+}
+
+//------------------------------------------------------------------------------
+
+void ResultFidelity::trim(PrEW::Fit::FitResult *result,
+                          const std::vector<std::size_t> &kept_pars) const {
+  /** Reduce the result to the kept parameters and quantities.
+   **/
+  if (m_level != Full) {
+    release(&(result->m_cor_matrix));
+  }
+  if (m_level == Values) {
+    release(&(result->m_uncs_ini));
+    release(&(result->m_uncs_fin));
+  }
+  if (m_categories.empty()) {
+    return;
+  }
+
+  keep_entries(&(result->m_par_names), kept_pars);
+  keep_entries(&(result->m_pars_ini), kept_pars);
+  keep_entries(&(result->m_pars_fin), kept_pars);
+  keep_entries(&(result->m_uncs_ini), kept_pars);
+  keep_entries(&(result->m_uncs_fin), kept_pars);
+  if (!result->m_cor_matrix.empty()) {
+    keep_entries(&(result->m_cor_matrix), kept_pars);
+    for (auto &row : result->m_cor_matrix) {
+      keep_entries(&row, kept_pars);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Runners
+} // namespace PrEWUtils
@@ -0,0 +1,44 @@
+#include <Runners/RunnerPolicies.h>
+
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Runners {
+
+//------------------------------------------------------------------------------
+
+Policies::RuntimeMinimizer::RuntimeMinimizer(
+    const std::string &prew_minimizer) {
+  /** Resolve the PrEW minimizer name.
+   **/
+  if (prew_minimizer == ChiSquared::name()) {
+    m_type = Type::ChiSquared;
+  } else if (prew_minimizer == PoissonNLL::name()) {
+    m_type = Type::PoissonNLL;
+  } else {
+    throw std::invalid_argument(
+        ("Unknown PrEW minimizer type " + prew_minimizer).c_str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Policies::OptionalSelection::set(DataHelp::BinSelector selector) {
+  m_bin_selector = selector;
+  m_use_selector = true;
+}
+
+const DataHelp::BinSelector *Policies::OptionalSelection::get() const {
+  return m_use_selector ? &m_bin_selector : nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+const DataHelp::BinSelector *Policies::NoSelection::get() const {
+  return nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Runners
+} // namespace PrEWUtils
@@ -0,0 +1,207 @@
+#include <Runners/StoppingPolicy.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Runners {
+
+//------------------------------------------------------------------------------
+// RunningMoments
+//------------------------------------------------------------------------------
+
+void RunningMoments::add(double x) {
+  /** Single-pass update of the central moments (Pebay 2008), numerically
+      stable also for large samples.
+   **/
+  double n_prev = m_n;
+  m_n += 1;
+  double delta = x - m_mean;
+  double delta_n = delta / m_n;
+  double delta_n2 = delta_n * delta_n;
+  double term = delta * delta_n * n_prev;
+
+  m_mean += delta_n;
+  m_m4 += term * delta_n2 * (m_n * m_n - 3 * m_n + 3) + 6 * delta_n2 * m_m2 -
+          4 * delta_n * m_m3;
+  m_m3 += term * delta_n * (m_n - 2) - 3 * delta_n * m_m2;
+  m_m2 += term;
+}
+
+double RunningMoments::get_width() const {
+  return (m_n > 0) ? std::sqrt(m_m2 / m_n) : 0.0;
+}
+
+double RunningMoments::get_kurtosis() const {
+  /** Non-excess kurtosis, 3 for a gaussian.
+   **/
+  return (m_m2 > 0) ? m_n * m_m4 / (m_m2 * m_m2) : 0.0;
+}
+
+//------------------------------------------------------------------------------
+// PrecisionStop
+//------------------------------------------------------------------------------
+
+PrecisionStop::PrecisionStop(double rel_precision, Quantity quantity,
+                             int min_toys, int max_toys)
+    : m_rel_precision(rel_precision), m_quantity(quantity),
+      m_min_toys(std::max(min_toys, 2)), m_max_toys(max_toys) {
+  if (rel_precision <= 0) {
+    throw std::invalid_argument("PrecisionStop: Precision must be positive.");
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PrecisionStop::start(const std::vector<int> &energies) {
+  m_moments.clear();
+  for (const auto &energy : energies) {
+    m_moments[energy] = {};
+  }
+  m_warned_max = false;
+}
+
+void PrecisionStop::add_result(const Output::ToyInfo &info,
+                               const PrEW::Fit::FitResult &result) {
+  if ((m_quantity == Quantity::Pulls) &&
+      (result.m_uncs_fin.size() < result.m_pars_fin.size())) {
+    throw std::invalid_argument(
+        "PrecisionStop: Pulls need the final uncertainties of the results.");
+  }
+  auto &moments = m_moments[info.m_energy];
+  moments.resize(std::max(moments.size(), result.m_pars_fin.size()));
+
+  for (std::size_t p = 0; p < result.m_pars_fin.size(); p++) {
+    if (m_quantity == Quantity::Values) {
+      moments[p].add(result.m_pars_fin[p]);
+    } else if (result.m_uncs_fin[p] > 0) {
+      moments[p].add((result.m_pars_fin[p] - result.m_pars_ini[p]) /
+                     result.m_uncs_fin[p]);
+    }
+  }
+}
+
+bool PrecisionStop::should_stop() const {
+  /** Stop when all parameters at all energies are precise enough, or when the
+      maximum number of toys is reached at all energies.
+   **/
+  if (m_moments.empty()) {
+    return false;
+  }
+
+  bool reached_max = (m_max_toys > 0);
+  bool all_precise = true;
+  for (const auto &energy_moments : m_moments) {
+    if (energy_moments.second.empty()) {
+      all_precise = false; // No toy of this energy finished yet
+    }
+    int n_toys = 0;
+    for (const auto &moments : energy_moments.second) {
+      n_toys = std::max(n_toys, static_cast<int>(moments.m_n));
+      if (!this->is_precise(moments)) {
+        all_precise = false;
+      }
+    }
+    if (n_toys < m_max_toys) {
+      reached_max = false;
+    }
+  }
+
+  if (reached_max && !all_precise && !m_warned_max) {
+    m_warned_max = true;
+    spdlog::warn("PrecisionStop: Reached {} toys before target precision {}.",
+                 m_max_toys, m_rel_precision);
+  }
+  return all_precise || reached_max;
+}
+
+bool PrecisionStop::needs_uncertainties() const {
+  return m_quantity == Quantity::Pulls;
+}
+
+//------------------------------------------------------------------------------
+
+const std::map<int, std::vector<RunningMoments>> &
+PrecisionStop::get_moments() const {
+  return m_moments;
+}
+
+//------------------------------------------------------------------------------
+
+bool PrecisionStop::is_precise(const RunningMoments &moments) const {
+  /** Relative to the width w, the mean is known to 1/sqrt(n) and the width to
+      sqrt((kurtosis - 1) / 4n).
+   **/
+  if (moments.m_n < m_min_toys) {
+    return false;
+  }
+  if (moments.m_m2 <= 0) {
+    return true; // No spread, nothing to estimate
+  }
+  double rel_unc_mean = 1.0 / std::sqrt(moments.m_n);
+  double rel_unc_width = std::sqrt(
+      std::max(moments.get_kurtosis() - 1.0, 0.0) / (4.0 * moments.m_n));
+  return (rel_unc_mean <= m_rel_precision) &&
+         (rel_unc_width <= m_rel_precision);
+}
+
+//------------------------------------------------------------------------------
+// WallClockStop
+//------------------------------------------------------------------------------
+
+WallClockStop::WallClockStop(std::chrono::duration<double> budget)
+    : m_budget(budget), m_start(Clock::now()) {}
+
+//------------------------------------------------------------------------------
+
+void WallClockStop::start(const std::vector<int> &) { m_start = Clock::now(); }
+
+void WallClockStop::add_result(const Output::ToyInfo &,
+                               const PrEW::Fit::FitResult &) {}
+
+bool WallClockStop::should_stop() const {
+  return (Clock::now() - m_start) >= m_budget;
+}
+
+//------------------------------------------------------------------------------
+// AnyStop
+//------------------------------------------------------------------------------
+
+AnyStop::AnyStop(std::vector<StoppingPolicy *> policies)
+    : m_policies(std::move(policies)) {}
+
+//------------------------------------------------------------------------------
+
+void AnyStop::start(const std::vector<int> &energies) {
+  for (auto *policy : m_policies) {
+    policy->start(energies);
+  }
+}
+
+void AnyStop::add_result(const Output::ToyInfo &info,
+                         const PrEW::Fit::FitResult &result) {
+  for (auto *policy : m_policies) {
+    policy->add_result(info, result);
+  }
+}
+
+bool AnyStop::should_stop() const {
+  return std::any_of(
+      m_policies.begin(), m_policies.end(),
+      [](const StoppingPolicy *policy) { return policy->should_stop(); });
+}
+
+bool AnyStop::needs_uncertainties() const {
+  return std::any_of(m_policies.begin(), m_policies.end(),
+                     [](const StoppingPolicy *policy) {
+                       return policy->needs_uncertainties();
+                     });
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Runners
+} // namespace PrEWUtils
@@ -0,0 +1,201 @@
+#include <Random/ToyFlct.h>
+#include <Runners/ToyPlan.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace PrEWUtils {
+namespace Runners {
+
+//------------------------------------------------------------------------------
+// Constructors
+
+ToyPlan::ToyPlan(const PrEW::Connect::DataConnector &connector,
+                 const PrEW::Data::PredDistrVec &expected,
+                 const PrEW::Fit::ParVec &pars,
+                 const DataHelp::BinSelector *selector)
+    : m_expected_bins(flatten_bins(expected)) {
+  /** Compile the plan from the expected distributions and the nominal fit
+      parameters.
+      The bin selection doesn't depend on the measurement, its mask is
+      evaluated here once on a scratch container.
+   **/
+  PrEW::Fit::FitContainer scratch{};
+  connector.fill_fit_container(expected, pars, &scratch);
+  check_unc_convention(scratch, m_expected_bins);
+
+  if (selector) {
+    spdlog::debug("ToyPlan: Evaluating bin selection.");
+    m_bin_mask = selector->get_mask(&scratch, expected);
+  } else {
+    m_bin_mask.assign(m_expected_bins.size(), true);
+  }
+  m_kept_bins = DataHelp::BinSelector::get_kept_indices(m_bin_mask);
+
+  for (int p = 0; p < static_cast<int>(pars.size()); p++) {
+    const auto &par = pars[static_cast<std::size_t>(p)];
+    m_start_vals.push_back(par.m_val_mod);
+    m_start_uncs.push_back(par.m_unc_mod);
+    if (par.has_constr()) {
+      m_constr_indices.push_back(p);
+      m_constr_vals.push_back(par.get_constrgauss().m_val);
+      m_constr_uncs.push_back(par.get_constrgauss().m_unc);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Access functions
+
+const std::vector<double> &ToyPlan::get_expected_bins() const {
+  return m_expected_bins;
+}
+
+const std::vector<int> &ToyPlan::get_kept_bins() const { return m_kept_bins; }
+
+//------------------------------------------------------------------------------
+
+void ToyPlan::set_start(const std::vector<double> &vals,
+                        const std::vector<double> &uncs) {
+  /** Let the toy fits start from the given parameter values, using the given
+      uncertainties as initial step sizes.
+      Non-positive uncertainties (e.g. of fixed parameters) keep the previous
+      step size.
+   **/
+  if ((vals.size() != m_start_vals.size()) ||
+      (uncs.size() != m_start_uncs.size())) {
+    throw std::invalid_argument("ToyPlan: Start values for " +
+                                std::to_string(vals.size()) +
+                                " parameters but plan has " +
+                                std::to_string(m_start_vals.size()));
+  }
+  m_start_vals = vals;
+  for (std::size_t p = 0; p < uncs.size(); p++) {
+    if (uncs[p] > 0) {
+      m_start_uncs[p] = uncs[p];
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ToyPlan::compact_bins(PrEW::Fit::FitContainer *container) const {
+  /** Reduce a freshly linked container to the bins kept by the selection,
+      in a single pass (see BinSelector::compact).
+   **/
+  DataHelp::BinSelector::compact(m_bin_mask, container);
+}
+
+//------------------------------------------------------------------------------
+
+void ToyPlan::set_toy(PrEW::Fit::FitContainer *container,
+                      const std::vector<double> &measured,
+                      Random::Philox &constr_rng) const {
+  /** Turn a compacted container into a toy: write the measured bin contents
+      and their uncertainties, reset the parameters to their start values and
+      fluctuate the constraint centres.
+      The container was filled from the expected distributions, everything
+      the connector derives from the measurement is overwritten here.
+   **/
+  auto &bins = container->m_fit_bins;
+  for (std::size_t b = 0; b < bins.size(); b++) {
+    set_measurement(&bins[b],
+                    measured[static_cast<std::size_t>(m_kept_bins[b])]);
+  }
+
+  auto &pars = container->m_fit_pars;
+  for (std::size_t p = 0; p < m_start_vals.size(); p++) {
+    pars[p].m_val_mod = m_start_vals[p];
+    pars[p].m_unc_mod = m_start_uncs[p];
+  }
+  for (std::size_t c = 0; c < m_constr_indices.size(); c++) {
+    pars[static_cast<std::size_t>(m_constr_indices[c])].set_constrgauss(
+        Random::ToyFlct::fluctuate_constr(m_constr_vals[c], m_constr_uncs[c],
+                                          constr_rng),
+        m_constr_uncs[c]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ToyPlan::set_asimov(PrEW::Fit::FitContainer *container) const {
+  /** Turn a compacted container into the Asimov dataset: the measurement is
+      the expectation and the constraints sit at their nominal centres.
+   **/
+  auto &bins = container->m_fit_bins;
+  for (std::size_t b = 0; b < bins.size(); b++) {
+    set_measurement(&bins[b],
+                    m_expected_bins[static_cast<std::size_t>(m_kept_bins[b])]);
+  }
+
+  auto &pars = container->m_fit_pars;
+  for (std::size_t p = 0; p < m_start_vals.size(); p++) {
+    pars[p].m_val_mod = m_start_vals[p];
+    pars[p].m_unc_mod = m_start_uncs[p];
+  }
+  for (std::size_t c = 0; c < m_constr_indices.size(); c++) {
+    pars[static_cast<std::size_t>(m_constr_indices[c])].set_constrgauss(
+        m_constr_vals[c], m_constr_uncs[c]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ToyPlan::set_measurement(PrEW::Fit::FitBin *bin, double measured) {
+  /** Set the measured content of the bin and its (Poisson) uncertainty, the
+      same way the connector does when filling a container.
+   **/
+  bin->set_val_mst(measured);
+  bin->set_unc_mst(std::sqrt(measured));
+}
+
+void ToyPlan::check_unc_convention(const PrEW::Fit::FitContainer &container,
+                                   const std::vector<double> &measured) {
+  /** Make sure the connector derives the measured uncertainties the way
+      set_measurement does, toys reuse a container filled once.
+   **/
+  const auto &bins = container.m_fit_bins;
+  if (bins.size() != measured.size()) {
+    throw std::logic_error("ToyPlan: Container has " +
+                           std::to_string(bins.size()) +
+                           " bins but distributions have " +
+                           std::to_string(measured.size()));
+  }
+  for (std::size_t b = 0; b < bins.size(); b++) {
+    double expected_unc = std::sqrt(measured[b]);
+    if (std::abs(bins[b].get_unc_mst() - expected_unc) >
+        1e-9 * std::max(1.0, expected_unc)) {
+      throw std::logic_error(
+          "ToyPlan: Connector uses unknown measured uncertainty in bin " +
+          std::to_string(b));
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<double>
+ToyPlan::flatten_bins(const PrEW::Data::PredDistrVec &distrs) {
+  /** Total (signal + background) content of all bins in one flat vector.
+   **/
+  std::vector<double> flat{};
+  for (const auto &distr : distrs) {
+    for (std::size_t b = 0; b < distr.m_sig_distr.size(); b++) {
+      double val = distr.m_sig_distr[b];
+      if (b < distr.m_bkg_distr.size()) {
+        val += distr.m_bkg_distr[b];
+      }
+      flat.push_back(val);
+    }
+  }
+  return flat;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Runners
+} // namespace PrEWUtils
@@ -0,0 +1,168 @@
+#include <Runners/ToyTiming.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Runners {
+namespace ToyTiming {
+
+//------------------------------------------------------------------------------
+// DurationHistogram
+
+void DurationHistogram::add(double seconds) {
+  int bin = 0;
+  if (seconds > 0) {
+    bin = static_cast<int>(
+              std::floor((std::log10(seconds) - min_exponent) *
+                         bins_per_decade)) +
+          1;
+  }
+  m_bins[static_cast<std::size_t>(std::max(0, std::min(bin, n_bins - 1)))]++;
+  m_count++;
+  m_total += seconds;
+  m_max = std::max(m_max, seconds);
+}
+
+void DurationHistogram::merge(const DurationHistogram &other) {
+  for (std::size_t b = 0; b < m_bins.size(); b++) {
+    m_bins[b] += other.m_bins[b];
+  }
+  m_count += other.m_count;
+  m_total += other.m_total;
+  m_max = std::max(m_max, other.m_max);
+}
+
+std::size_t DurationHistogram::get_count() const { return m_count; }
+double DurationHistogram::get_total() const { return m_total; }
+double DurationHistogram::get_max() const { return m_max; }
+
+double DurationHistogram::get_quantile(double q) const {
+  /** Estimate of the q-quantile, the geometric centre of the bin it falls
+      into (never above the largest duration).
+   **/
+  if (m_count == 0) {
+    return 0;
+  }
+  auto target = static_cast<std::size_t>(std::ceil(q * m_count));
+  target = std::max<std::size_t>(target, 1);
+  std::size_t n_seen = 0;
+  for (int b = 0; b < n_bins; b++) {
+    n_seen += m_bins[static_cast<std::size_t>(b)];
+    if (n_seen >= target) {
+      double exponent = min_exponent + (b - 0.5) / bins_per_decade;
+      return std::min(std::pow(10.0, exponent), m_max);
+    }
+  }
+  return m_max;
+}
+
+//------------------------------------------------------------------------------
+// StageTimings
+
+void StageTimings::add(std::size_t stage, Clock::duration duration) {
+  if (stage >= m_stages.size()) {
+    m_stages.resize(stage + 1);
+  }
+  m_stages[stage].add(std::chrono::duration<double>(duration).count());
+}
+
+void StageTimings::merge(const StageTimings &other) {
+  if (other.m_stages.size() > m_stages.size()) {
+    m_stages.resize(other.m_stages.size());
+  }
+  for (std::size_t s = 0; s < other.m_stages.size(); s++) {
+    m_stages[s].merge(other.m_stages[s]);
+  }
+}
+
+const std::vector<DurationHistogram> &StageTimings::get_stages() const {
+  return m_stages;
+}
+
+//------------------------------------------------------------------------------
+// Reports
+
+StatsVec summarize(const StageTimings &timings, std::size_t n_stages) {
+  /** Summary statistics of the first n_stages stages.
+   **/
+  StatsVec stats(n_stages);
+  const auto &stages = timings.get_stages();
+  for (std::size_t s = 0; s < std::min(n_stages, stages.size()); s++) {
+    const auto &histogram = stages[s];
+    auto &stage_stats = stats[s];
+    stage_stats.m_count = histogram.get_count();
+    stage_stats.m_total = histogram.get_total();
+    if (stage_stats.m_count > 0) {
+      stage_stats.m_mean = stage_stats.m_total / stage_stats.m_count;
+    }
+    stage_stats.m_p50 = histogram.get_quantile(0.5);
+    stage_stats.m_p90 = histogram.get_quantile(0.9);
+    stage_stats.m_p99 = histogram.get_quantile(0.99);
+    stage_stats.m_max = histogram.get_max();
+  }
+  return stats;
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+void stats_to_json(std::ostream &out, const std::vector<std::string> &stages,
+                   const StatsVec &stats) {
+  out << "{";
+  for (std::size_t s = 0; s < stats.size(); s++) {
+    const auto &stage_stats = stats[s];
+    out << (s > 0 ? ", " : "") << "\"" << stages.at(s) << "\": {"
+        << "\"count\": " << stage_stats.m_count
+        << ", \"total\": " << stage_stats.m_total
+        << ", \"mean\": " << stage_stats.m_mean
+        << ", \"p50\": " << stage_stats.m_p50
+        << ", \"p90\": " << stage_stats.m_p90
+        << ", \"p99\": " << stage_stats.m_p99
+        << ", \"max\": " << stage_stats.m_max << "}";
+  }
+  out << "}";
+}
+
+} // namespace
+
+std::string TimingReport::to_json() const {
+  /** JSON representation of the report, times in seconds.
+   **/
+  std::ostringstream out{};
+  out.precision(6);
+  out << "{\n  \"wall_time\": " << m_wall_time << ",\n  \"energies\": {";
+  bool is_first = true;
+  for (const auto &energy_stats : m_energies) {
+    out << (is_first ? "\n" : ",\n") << "    \"" << energy_stats.first
+        << "\": ";
+    stats_to_json(out, m_stages, energy_stats.second);
+    is_first = false;
+  }
+  out << "\n  },\n  \"workers\": [";
+  for (std::size_t w = 0; w < m_workers.size(); w++) {
+    out << (w > 0 ? ",\n" : "\n") << "    ";
+    stats_to_json(out, m_stages, m_workers[w]);
+  }
+  out << "\n  ]\n}\n";
+  return out.str();
+}
+
+void TimingReport::write_json(const std::string &path) const {
+  std::ofstream file(path);
+  file << this->to_json();
+  file.close();
+  if (!file) {
+    throw std::runtime_error("TimingReport: Failed writing " + path);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace ToyTiming
+} // namespace Runners
+} // namespace PrEWUtils
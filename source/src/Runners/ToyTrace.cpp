@@ -0,0 +1,342 @@
+#include <Runners/ToyTrace.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace PrEWUtils {
+namespace Runners {
+namespace ToyTrace {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+// Trace file header
+const char trace_magic[8] = {'P', 'R', 'E', 'W', 'T', 'R', 'C', '1'};
+
+std::atomic<std::uint64_t> &next_tracer_id() {
+  static std::atomic<std::uint64_t> id{1};
+  return id;
+}
+
+// Tracers that are alive, by ID, only those get rings back from exiting
+// threads
+std::mutex &live_tracers_mutex() {
+  static std::mutex mutex{};
+  return mutex;
+}
+
+std::map<std::uint64_t, Tracer *> &live_tracers() {
+  static std::map<std::uint64_t, Tracer *> tracers{};
+  return tracers;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// EventRing
+
+EventRing::EventRing(std::size_t capacity) {
+  std::size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  m_events.resize(size);
+  m_mask = size - 1;
+}
+
+bool EventRing::push(const Event &event) {
+  /** Append the event unless the ring is full, never blocks.
+   **/
+  auto head = m_head.load(std::memory_order_relaxed);
+  if (head - m_tail.load(std::memory_order_acquire) > m_mask) {
+    m_n_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  m_events[head & m_mask] = event;
+  m_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+void EventRing::pop_all(EventVec *events) {
+  /** Move all events written so far to the end of the given vector.
+   **/
+  auto tail = m_tail.load(std::memory_order_relaxed);
+  auto head = m_head.load(std::memory_order_acquire);
+  for (; tail != head; tail++) {
+    events->push_back(m_events[tail & m_mask]);
+  }
+  m_tail.store(tail, std::memory_order_release);
+}
+
+std::size_t EventRing::get_n_dropped() const {
+  return m_n_dropped.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// Tracer
+
+Tracer::Tracer(const std::string &path,
+               std::chrono::milliseconds progress_interval,
+               std::size_t ring_capacity)
+    : m_id(next_tracer_id().fetch_add(1)), m_ring_capacity(ring_capacity),
+      m_start(std::chrono::steady_clock::now()),
+      m_progress_interval(progress_interval) {
+  /** Create a tracer writing its events into the given file (no file if the
+      path is empty) and logging the progress at the given interval (never if
+      it is zero).
+   **/
+  {
+    std::lock_guard<std::mutex> lock(live_tracers_mutex());
+    live_tracers()[m_id] = this;
+  }
+  if (!path.empty()) {
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+      throw std::runtime_error("ToyTrace: Can't open trace file " + path);
+    }
+    m_file.write(trace_magic, sizeof(trace_magic));
+  }
+  m_flush_thread = std::thread(&Tracer::flush_loop, this);
+}
+
+Tracer::~Tracer() {
+  /** Write the remaining events and log the final summary.
+   **/
+  {
+    std::lock_guard<std::mutex> lock(live_tracers_mutex());
+    live_tracers().erase(m_id);
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_flush_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+  m_flush_thread.join();
+}
+
+//------------------------------------------------------------------------------
+
+void Tracer::toy_start(int energy, int toy_index) {
+  auto *ring = this->local_ring();
+  ring->m_energy = energy;
+  ring->m_toy_index = toy_index;
+  this->record(ring, ToyStart, 0, 0);
+}
+
+void Tracer::stage_end(std::size_t stage) {
+  this->record(this->local_ring(), StageEnd, stage, 0);
+}
+
+void Tracer::minimizer_end(std::size_t minimizer, int status) {
+  this->record(this->local_ring(), MinimizerEnd, minimizer, status);
+}
+
+void Tracer::toy_end(int status) {
+  this->record(this->local_ring(), ToyEnd, 0, status);
+}
+
+//------------------------------------------------------------------------------
+
+Progress Tracer::get_progress() const {
+  /** Progress as of the last flush.
+   **/
+  std::lock_guard<std::mutex> lock(m_progress_mutex);
+  return m_progress;
+}
+
+//------------------------------------------------------------------------------
+
+EventVec Tracer::read_events(const std::string &path) {
+  /** Read all events of a trace file.
+   **/
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(trace_magic)]{};
+  if (!file.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), trace_magic)) {
+    throw std::runtime_error("ToyTrace: Not a trace file " + path);
+  }
+  EventVec events{};
+  Event event{};
+  while (file.read(reinterpret_cast<char *>(&event), sizeof(Event))) {
+    events.push_back(event);
+  }
+  return events;
+}
+
+//------------------------------------------------------------------------------
+// Internal functions
+
+Tracer::ThreadCache::~ThreadCache() {
+  std::lock_guard<std::mutex> lock(live_tracers_mutex());
+  const auto &tracers = live_tracers();
+  for (const auto &cached : m_rings) {
+    auto tracer_it = tracers.find(cached.first);
+    if (tracer_it != tracers.end()) {
+      tracer_it->second->release_ring(cached.second);
+    }
+  }
+}
+
+Tracer::ThreadCache &Tracer::thread_cache() {
+  thread_local ThreadCache cache{};
+  return cache;
+}
+
+Tracer::ThreadRing *Tracer::local_ring() {
+  /** Ring of the calling thread, taken on its first event from the rings of
+      exited threads or newly created.
+   **/
+  auto &cache = thread_cache().m_rings;
+  for (const auto &cached : cache) {
+    if (cached.first == m_id) {
+      return cached.second;
+    }
+  }
+
+  // Forget the rings of tracers that are gone
+  {
+    std::lock_guard<std::mutex> lock(live_tracers_mutex());
+    const auto &tracers = live_tracers();
+    cache.erase(std::remove_if(cache.begin(), cache.end(),
+                               [&tracers](const auto &cached) {
+                                 return tracers.count(cached.first) == 0;
+                               }),
+                cache.end());
+  }
+
+  ThreadRing *ring_ptr = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(m_rings_mutex);
+    for (auto &ring : m_rings) {
+      if (!ring->m_in_use) {
+        ring->m_in_use = true;
+        ring_ptr = ring.get();
+        break;
+      }
+    }
+    if (!ring_ptr) {
+      auto ring = std::make_unique<ThreadRing>();
+      ring->m_ring = std::make_unique<EventRing>(m_ring_capacity);
+      ring_ptr = ring.get();
+      m_rings.push_back(std::move(ring));
+    }
+  }
+  cache.emplace_back(m_id, ring_ptr);
+  return ring_ptr;
+}
+
+void Tracer::release_ring(ThreadRing *ring) {
+  /** Hand the ring of an exiting thread back for reuse, its remaining events
+      are still flushed.
+   **/
+  std::lock_guard<std::mutex> lock(m_rings_mutex);
+  ring->m_in_use = false;
+}
+
+void Tracer::record(ThreadRing *ring, EventType type, std::size_t stage,
+                    int value) {
+  Event event{};
+  event.m_time_ns = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - m_start)
+          .count());
+  event.m_energy = ring->m_energy;
+  event.m_toy_index = ring->m_toy_index;
+  event.m_type = type;
+  event.m_stage = static_cast<std::uint16_t>(stage);
+  event.m_value = value;
+  ring->m_ring->push(event);
+}
+
+//------------------------------------------------------------------------------
+
+void Tracer::flush_loop() {
+  /** Drain the rings regularly until the tracer is destroyed.
+   **/
+  const auto flush_interval = std::chrono::milliseconds(50);
+  auto last_progress = std::chrono::steady_clock::now();
+  while (true) {
+    bool stopping = false;
+    {
+      std::unique_lock<std::mutex> lock(m_flush_mutex);
+      m_wake.wait_for(lock, flush_interval, [this] { return m_stopping; });
+      stopping = m_stopping;
+    }
+    this->flush();
+    if (stopping) {
+      break;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if ((m_progress_interval.count() > 0) &&
+        (now - last_progress >= m_progress_interval)) {
+      this->log_progress();
+      last_progress = now;
+    }
+  }
+  if (m_progress_interval.count() > 0) {
+    this->log_progress();
+  }
+}
+
+void Tracer::flush() {
+  /** Move the events of all rings into the file and the progress.
+   **/
+  EventVec events{};
+  std::size_t n_dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_rings_mutex);
+    for (auto &ring : m_rings) {
+      ring->m_ring->pop_all(&events);
+      n_dropped += ring->m_ring->get_n_dropped();
+    }
+  }
+
+  if (m_file.is_open() && !events.empty()) {
+    m_file.write(reinterpret_cast<const char *>(events.data()),
+                 static_cast<std::streamsize>(events.size() * sizeof(Event)));
+    m_file.flush();
+  }
+
+  std::lock_guard<std::mutex> lock(m_progress_mutex);
+  for (const auto &event : events) {
+    if (event.m_type == ToyStart) {
+      m_progress.m_energies[event.m_energy].m_n_started++;
+    } else if (event.m_type == ToyEnd) {
+      auto &progress = m_progress.m_energies[event.m_energy];
+      progress.m_n_finished++;
+      progress.m_n_failed += (event.m_value != 0) ? 1 : 0;
+    }
+  }
+  m_progress.m_n_dropped = n_dropped;
+  m_progress.m_elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - m_start)
+                             .count();
+}
+
+void Tracer::log_progress() const {
+  /** One summary line per energy instead of one line per toy.
+   **/
+  auto progress = this->get_progress();
+  for (const auto &energy_progress : progress.m_energies) {
+    const auto &energy = energy_progress.second;
+    spdlog::info("ToyTrace: E={}: {} toys finished ({:.1f}/s), {} failed, {} "
+                 "running.",
+                 energy_progress.first, energy.m_n_finished,
+                 energy.m_n_finished / std::max(progress.m_elapsed, 1e-9),
+                 energy.m_n_failed, energy.m_n_started - energy.m_n_finished);
+  }
+  if (progress.m_n_dropped > 0) {
+    spdlog::warn("ToyTrace: {} events dropped, trace buffers too small.",
+                 progress.m_n_dropped);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace ToyTrace
+} // namespace Runners
+} // namespace PrEWUtils
@@ -0,0 +1,108 @@
+#include <Runners/ToyWorkspace.h>
+
+#include "spdlog/spdlog.h"
+
+namespace PrEWUtils {
+namespace Runners {
+
+//------------------------------------------------------------------------------
+// Constructors
+
+ToyWorkspace::ToyWorkspace(const PrEW::Connect::DataConnector &connector,
+                           const PrEW::Data::PredDistrVec &expected,
+                           const PrEW::Fit::ParVec &pars, const ToyPlan *plan)
+    : m_plan(plan), m_measured(plan->get_expected_bins().size()) {
+  /** Link the container once using the expected distributions and reduce it
+      to the bins selected in the plan.
+   **/
+  spdlog::debug("ToyWorkspace: Linking fit container.");
+  connector.fill_fit_container(expected, pars, &m_container);
+  m_plan->compact_bins(&m_container);
+}
+
+//------------------------------------------------------------------------------
+
+const ToyPlan *ToyWorkspace::get_plan() const { return m_plan; }
+
+std::vector<double> *ToyWorkspace::get_measured_buffer() {
+  /** Buffer into which the toy measurement is to be written, flat in the
+      order of ToyPlan::flatten_bins.
+   **/
+  return &m_measured;
+}
+
+//------------------------------------------------------------------------------
+
+PrEW::Fit::FitContainer *
+ToyWorkspace::prepare_toy(Random::Philox &constr_rng) {
+  /** Move the measurement in the buffer into the container and reset the
+      parameters to the toy's start values and constraints.
+   **/
+  m_plan->set_toy(&m_container, m_measured, constr_rng);
+  return &m_container;
+}
+
+PrEW::Fit::FitContainer *ToyWorkspace::prepare_asimov() {
+  /** Set the container to the unfluctuated Asimov dataset.
+   **/
+  m_plan->set_asimov(&m_container);
+  return &m_container;
+}
+
+//------------------------------------------------------------------------------
+
+double ToyWorkspace::get_seconds_per_call() const {
+  return m_seconds_per_call;
+}
+
+void ToyWorkspace::calibrate_calls() {
+  /** Conservative first estimate of the time per FCN call, before any
+      minimization was timed: an FCN call evaluates every bin prediction, the
+      time of such passes over the container is taken twice (for the rest of
+      the FCN and the minimizer overhead).
+      Replaced by the first timed minimization.
+   **/
+  using Clock = std::chrono::steady_clock;
+  const auto &bins = m_container.m_fit_bins;
+  const int min_passes = 3;
+  const std::chrono::microseconds min_duration(200);
+
+  volatile double sum = 0; // Keep the evaluation from being optimised away
+  int n_passes = 0;
+  auto start = Clock::now();
+  std::chrono::duration<double> duration{0};
+  while ((n_passes < min_passes) || (duration < min_duration)) {
+    for (const auto &bin : bins) {
+      sum = sum + bin.get_val_prd();
+    }
+    n_passes++;
+    duration = Clock::now() - start;
+  }
+  m_seconds_per_call = 2.0 * duration.count() / n_passes;
+}
+
+void ToyWorkspace::add_timing(std::chrono::duration<double> duration,
+                              int n_calls) {
+  /** Update the running estimate of the time per FCN call with a finished
+      minimization, recent minimizations weigh more.
+   **/
+  if (n_calls <= 0) {
+    return;
+  }
+  double seconds_per_call = duration.count() / n_calls;
+  if (!m_calls_timed) {
+    m_calls_timed = true; // Calibration is only a stand-in
+  } else if (m_seconds_per_call > 0) {
+    seconds_per_call = 0.8 * m_seconds_per_call + 0.2 * seconds_per_call;
+  }
+  m_seconds_per_call = seconds_per_call;
+}
+
+//------------------------------------------------------------------------------
+
+ToyTiming::StageTimings *ToyWorkspace::get_timings() { return &m_timings; }
+
+//------------------------------------------------------------------------------
+
+} // namespace Runners
+} // namespace PrEWUtils
@@ -22,6 +22,18 @@ GeneralSetup::GeneralSetup(int energy) : m_energy(energy) {}
 
 //------------------------------------------------------------------------------
 
+void GeneralSetup::add_input(const PrEW::Data::PredDistrVec &distrs,
+                             const PrEW::Data::CoefDistrVec &coefs) {
+  /** Add distributions and coefficients that don't come from an input file,
+      e.g. ones that were generated in memory.
+   **/
+  // Adding them to input vectors for later use
+  m_input_distrs.insert(m_input_distrs.end(), distrs.begin(), distrs.end());
+  m_input_coefs.insert(m_input_coefs.end(), coefs.begin(), coefs.end());
+}
+
+//------------------------------------------------------------------------------
+
 void GeneralSetup::add_input_file(const std::string &file_path,
                                   const std::string &file_type) {
   /** Read the distributions and coefficients from the file which is of the
@@ -41,11 +53,7 @@ void GeneralSetup::add_input_file(const std::string &file_path,
   reader.read_file();
 
   // Use the new info from the file
-  auto new_pred = reader.get_pred_distrs();
-  auto new_coef = reader.get_coef_distrs();
-  // Adding results to input vectors for later use
-  m_input_distrs.insert(m_input_distrs.end(), new_pred.begin(), new_pred.end());
-  m_input_coefs.insert(m_input_coefs.end(), new_coef.begin(), new_coef.end());
+  this->add_input(reader.get_pred_distrs(), reader.get_coef_distrs());
 
   delete info;
 }
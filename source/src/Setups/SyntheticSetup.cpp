@@ -0,0 +1,194 @@
+#include <Setups/SyntheticSetup.h>
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace PrEWUtils {
+namespace Setups {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+// Coefficient names of the "JB" TGC naming style (see SetupHelp/TGCInfo.cpp)
+const std::vector<std::string> TGC_coef_names{
+    "TGC_k_g",  "TGC_k_k",  "TGC_k_l",  "TGC_k_g2", "TGC_k_k2",
+    "TGC_k_l2", "TGC_k_gk", "TGC_k_gl", "TGC_k_kl"};
+
+const std::string coord_index_name{"SynthCosThetaIndex"};
+
+double bin_center(int bin, int n_bins) {
+  return -1.0 + (bin + 0.5) * 2.0 / n_bins;
+}
+
+bool has_chiral_config(const SyntheticSetup::Config &config,
+                       const std::string &chiral_config) {
+  const auto &configs = config.m_chiral_configs;
+  return std::find(configs.begin(), configs.end(), chiral_config) !=
+         configs.end();
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+std::string SyntheticSetup::distr_name(int distr_index) {
+  return "SynthDistr" + std::to_string(distr_index);
+}
+
+//------------------------------------------------------------------------------
+
+PrEW::Data::PredDistrVec
+SyntheticSetup::make_distrs(const SyntheticSetup::Config &config) {
+  /** Distributions of all distribution names and chiral configurations.
+      Shape 1 + cos^2 + A cos with an asymmetry A depending on the chiral
+      configuration, the background is a flat tenth of the mean signal.
+   **/
+  if ((config.m_n_distrs < 1) || (config.m_n_bins < 1)) {
+    throw std::invalid_argument("SyntheticSetup: Need at least one "
+                                "distribution with at least one bin!");
+  }
+
+  PrEW::Data::PredDistrVec distrs{};
+  for (int d = 0; d < config.m_n_distrs; d++) {
+    for (std::size_t c = 0; c < config.m_chiral_configs.size(); c++) {
+      PrEW::Data::PredDistr distr{};
+      distr.m_info = {distr_name(d), config.m_chiral_configs[c],
+                      config.m_energy};
+
+      double norm = 1000.0 * (1 + d % 7) / static_cast<double>(1 + c);
+      double asymm = (c % 2 == 0) ? 0.5 : -0.5;
+      for (int b = 0; b < config.m_n_bins; b++) {
+        double x = bin_center(b, config.m_n_bins);
+        double val = norm * (1.0 + x * x + asymm * x) / config.m_n_bins;
+        distr.m_coords.emplace_back(std::vector<double>{x});
+        distr.m_sig_distr.push_back(val);
+        distr.m_bkg_distr.push_back(0.1 * 4.0 / 3.0 * norm / config.m_n_bins);
+      }
+      distrs.push_back(distr);
+    }
+  }
+  return distrs;
+}
+
+//------------------------------------------------------------------------------
+
+PrEW::Data::CoefDistrVec
+SyntheticSetup::make_coefs(const SyntheticSetup::Config &config) {
+  /** Input coefficients needed by the configured blocks, i.e. the
+      differential TGC coefficients if TGCs are used.
+   **/
+  PrEW::Data::CoefDistrVec coefs{};
+  if (!config.m_use_TGCs) {
+    return coefs;
+  }
+
+  for (int d = 0; d < config.m_n_distrs; d++) {
+    for (const auto &chiral_config : config.m_chiral_configs) {
+      PrEW::Data::DistrInfo info{distr_name(d), chiral_config,
+                                 config.m_energy};
+      for (std::size_t k = 0; k < TGC_coef_names.size(); k++) {
+        // Linear coefficients odd in cos(theta), quadratic ones even
+        std::vector<double> vals{};
+        for (int b = 0; b < config.m_n_bins; b++) {
+          double x = bin_center(b, config.m_n_bins);
+          vals.push_back((k < 3) ? 0.1 * (k + 1) * x : 0.01 * (1.0 + x * x));
+        }
+        coefs.push_back(PrEW::Data::CoefDistr(TGC_coef_names[k], info, vals));
+      }
+    }
+  }
+  return coefs;
+}
+
+//------------------------------------------------------------------------------
+
+GeneralSetup SyntheticSetup::make_setup(const SyntheticSetup::Config &config) {
+  /** Setup using all distributions with a polarised run (4 polarisation
+      configurations, constrained luminosity and polarisations) and the
+      configured blocks.
+      Like any GeneralSetup it still needs to be completed before use.
+   **/
+  GeneralSetup setup(config.m_energy);
+  setup.add_input(make_distrs(config), make_coefs(config));
+
+  SetupHelp::RunInfo run(config.m_energy);
+  run.set_lumi(2000, 2);
+  run.add_pol("ePol", 0.8);
+  run.add_pol("pPol", 0.3);
+  run.add_pol_config("-+", "ePol", "pPol", "-", "+", 0.45);
+  run.add_pol_config("+-", "ePol", "pPol", "+", "-", 0.45);
+  run.add_pol_config("--", "ePol", "pPol", "-", "-", 0.05);
+  run.add_pol_config("++", "ePol", "pPol", "+", "+", 0.05);
+  run.add_lumi_constr(2000, 2);
+  run.add_pol_constr("ePol", 0.8, 0.001);
+  run.add_pol_constr("pPol", 0.3, 0.001);
+  setup.set_run(run);
+
+  std::vector<std::string> names{};
+  for (int d = 0; d < config.m_n_distrs; d++) {
+    names.push_back(distr_name(d));
+  }
+
+  for (const auto &name : names) {
+    setup.use_distr(name);
+
+    if (config.m_use_xsections) {
+      SetupHelp::CrossSectionInfo xs_info(name, config.m_chiral_configs);
+      if (config.m_chiral_configs.size() > 1) {
+        xs_info.use_chiral_asymmetries();
+      }
+      xs_info.use_total_chiral_cross_section();
+      setup.add(xs_info);
+    }
+    if (config.m_use_const_effs) {
+      SetupHelp::ConstEffInfo eff_info(name, 0.8);
+      eff_info.constrain(0.8, 0.01);
+      setup.add(eff_info);
+    }
+    if (config.m_use_acc_boxes) {
+      SetupHelp::AccBoxInfo box_info(name + "_Acceptance", coord_index_name,
+                                     0, 1.8);
+      box_info.add_distr(name, 0, 2.0 / config.m_n_bins);
+      setup.add(box_info);
+    }
+  }
+
+  if (config.m_use_TGCs) {
+    setup.add(SetupHelp::TGCInfo(names, "quadratic", "JB"));
+  }
+
+  spdlog::debug("SyntheticSetup: Created setup with {} distributions.",
+                names.size());
+  return setup;
+}
+
+//------------------------------------------------------------------------------
+
+FitModifier
+SyntheticSetup::make_modifier(const SyntheticSetup::Config &config) {
+  /** Modifier replacing the distributions by their Af parametrisation, needs
+      the eLpR and eRpL chiral configurations.
+      Without Af blocks the modifier leaves the setup unchanged.
+   **/
+  FitModifier modifier(config.m_energy);
+  if (!config.m_use_Af) {
+    return modifier;
+  }
+  if (!has_chiral_config(config, PrEW::GlobalVar::Chiral::eLpR) ||
+      !has_chiral_config(config, PrEW::GlobalVar::Chiral::eRpL)) {
+    throw std::invalid_argument(
+        "SyntheticSetup: Af needs the eLpR and eRpL chiral configurations!");
+  }
+  for (int d = 0; d < config.m_n_distrs; d++) {
+    modifier.add(SetupHelp::AfInfo(distr_name(d)));
+  }
+  return modifier;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace Setups
+} // namespace PrEWUtils
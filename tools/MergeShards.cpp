@@ -0,0 +1,104 @@
+/** Combine the result files of the shards of a toy campaign into a single
+    result file.
+    All shard files must stem from the same setup. Toys that occur in more
+    than one file and toys missing in [0, N_toys) are reported, the merged
+    file is only written if there are none (unless --allow-gaps is given, in
+    which case gaps and duplicates are only reported).
+
+    Usage: ./MergeShards --out=merged.bin [--toys=N_toys] [--allow-gaps]
+                         shard_0.bin shard_1.bin ...
+**/
+
+#include <Output/ResultIO.h>
+#include <Output/ShardMerge.h>
+
+#include <cstdio>
+#include <exception>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+void print_indices(const char *what,
+                   const std::map<int, std::vector<int>> &indices) {
+  /** Print toy indices per energy, contiguous indices as ranges.
+   **/
+  for (const auto &energy_indices : indices) {
+    std::printf("%s @ E=%d (%zu):", what, energy_indices.first,
+                energy_indices.second.size());
+    const auto &list = energy_indices.second;
+    for (std::size_t i = 0; i < list.size(); i++) {
+      std::size_t last = i;
+      while ((last + 1 < list.size()) && (list[last + 1] == list[last] + 1)) {
+        last++;
+      }
+      if (last == i) {
+        std::printf(" %d", list[i]);
+      } else {
+        std::printf(" %d-%d", list[i], list[last]);
+      }
+      i = last;
+    }
+    std::printf("\n");
+  }
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string out_path{};
+  int n_toys = 0;
+  bool allow_gaps = false;
+  std::vector<std::string> files{};
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 6, "--out=") == 0) {
+      out_path = arg.substr(6);
+    } else if (arg.compare(0, 7, "--toys=") == 0) {
+      n_toys = std::stoi(arg.substr(7));
+    } else if (arg == "--allow-gaps") {
+      allow_gaps = true;
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (out_path.empty() || files.empty()) {
+    std::printf("Usage: %s --out=merged.bin [--toys=N_toys] [--allow-gaps] "
+                "shard_0.bin shard_1.bin ...\n",
+                argv[0]);
+    return 2;
+  }
+
+  try {
+    PrEWUtils::Output::ShardMerge::MergeReport report{};
+    auto merged =
+        PrEWUtils::Output::ShardMerge::merge_files(files, n_toys, &report);
+
+    std::printf("Merged %zu files: %zu toys, fingerprint %llx\n", files.size(),
+                report.m_n_results,
+                static_cast<unsigned long long>(report.m_fingerprint));
+    print_indices("Duplicates", report.m_duplicates);
+    print_indices("Gaps", report.m_gaps);
+
+    if (!report.is_complete() && !allow_gaps) {
+      std::printf("Not writing %s, campaign is incomplete.\n",
+                  out_path.c_str());
+      return 1;
+    }
+    PrEWUtils::Output::ResultIO::write_file(
+        out_path, report.m_fingerprint,
+        PrEWUtils::Output::ShardMerge::flatten(merged));
+    std::printf("Wrote %s\n", out_path.c_str());
+  } catch (const std::exception &error) {
+    std::printf("Error: %s\n", error.what());
+    return 1;
+  }
+
+  return 0;
+}